@@ -45,9 +45,7 @@ typedef int OpenFileId;
 
 class FileSystem {
    public:
-    FileSystem() {
-        for (int i = 0; i < 20; i++) OpenFileTable[i] = NULL;
-    }
+    FileSystem() {}
 
     bool Create(char *name) {
         int fileDescriptor = OpenForWrite(name);
@@ -58,15 +56,6 @@ class FileSystem {
         return TRUE;
     }
 
-    int SeekEntry() {
-        for (short i = 0; i < 20; i++) {
-            if (!OpenFileTable[i]) {
-                return i;
-            }
-        }
-        return -1;
-    }
-
     // The OpenFile function is used for open user program  [userprog/addrspace.cc]
     OpenFile *Open(char *name) {
         int fileDescriptor = OpenForReadWrite(name, FALSE);
@@ -75,58 +64,7 @@ class FileSystem {
         return new OpenFile(fileDescriptor);
     }
 
-    //  The OpenAFile function is used for kernel open system call
-    OpenFileId OpenAFile(char *name) {
-        int id = SeekEntry();
-        if (id == -1) {
-            return -1;
-        }
-
-        int fileDescriptor = OpenForReadWrite(name, FALSE);
-        if (fileDescriptor == -1)
-            return -1;
-
-        OpenFileTable[id] = new OpenFile(fileDescriptor);
-        return id;
-    }
-    
-    int WriteAFile(char *buffer, int size, OpenFileId id){
-        if (id < 0 || id >= 20) {
-            return -1;
-        }
-        if (!OpenFileTable[id]) {
-            return -1;
-        }
-
-        return OpenFileTable[id]->Write(buffer, size);
-    }
-
-    int ReadAFile(char *buffer, int size, OpenFileId id){
-        if (id < 0 || id >= 20) {
-            return -1;
-        }
-        if (!OpenFileTable[id]) {
-            return -1;
-        }
-
-        return OpenFileTable[id]->Read(buffer, size);
-    }
-
-    int CloseAFile(OpenFileId id){
-        if (id < 0 || id >= 20) {
-            return -1;
-        }
-        if (!OpenFileTable[id]) {
-            return -1;
-        }
-        delete OpenFileTable[id];
-        OpenFileTable[id] = NULL;
-        return 1;
-    }
-
     bool Remove(char *name) { return Unlink(name) == 0; }
-
-    OpenFile *OpenFileTable[20];
 };
 
 #else  // FILESYS
@@ -54,6 +54,7 @@ class OpenFile {
         currentOffset += numWritten;
         return numWritten;
     }
+    void Seek(int position) { currentOffset = position; }
 
     int Length() {
         Lseek(file, 0, 2);
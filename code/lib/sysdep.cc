@@ -143,6 +143,18 @@ void UDelay(unsigned int useconds) {
     // #endif /* SOLARIS */
 }
 
+//----------------------------------------------------------------------
+// HostMicroseconds
+// 	Return the time of day on the host, in microseconds.
+//----------------------------------------------------------------------
+
+double HostMicroseconds() {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
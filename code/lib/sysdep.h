@@ -27,6 +27,10 @@ extern void Exit(int exitCode);
 extern void Delay(int seconds);
 extern void UDelay(unsigned int usec);  // rcgood - to avoid spinners.
 
+// Wall-clock time of the host, in microseconds, for measuring how long
+// the simulation itself takes
+extern double HostMicroseconds();
+
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(void (*cleanup)(int));
 
@@ -80,7 +80,7 @@ void ConsoleInput::CallBack() {
             // save the character and notify the OS that
             // it is available
             ASSERT(readCount == sizeof(char));
-            incoming = c;
+            incoming = (unsigned char)c;
             kernel->stats->numConsoleCharsRead++;
         }
         callWhenAvail->CallBack();
@@ -93,8 +93,8 @@ void ConsoleInput::CallBack() {
 //	Either return the character, or EOF if none buffered.
 //----------------------------------------------------------------------
 
-char ConsoleInput::GetChar() {
-    char ch = incoming;
+int ConsoleInput::GetChar() {
+    int ch = incoming;
 
     if (incoming != EOF) {  // schedule when next char will arrive
         kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
@@ -120,6 +120,7 @@ ConsoleOutput::ConsoleOutput(char *writeFile, CallBackObj *toCall) {
 
     callWhenDone = toCall;
     putBusy = FALSE;
+    numPending = 0;
 }
 
 //----------------------------------------------------------------------
@@ -141,7 +142,8 @@ ConsoleOutput::~ConsoleOutput() {
 void ConsoleOutput::CallBack() {
     DEBUG(dbgTraCode, "In ConsoleOutput::CallBack(), " << kernel->stats->totalTicks);
     putBusy = FALSE;
-    kernel->stats->numConsoleCharsWritten++;
+    kernel->stats->numConsoleCharsWritten += numPending;
+    numPending = 0;
     callWhenDone->CallBack();
 }
 
@@ -155,5 +157,22 @@ void ConsoleOutput::PutChar(char ch) {
     ASSERT(putBusy == FALSE);
     WriteFile(writeFileNo, &ch, sizeof(char));
     putBusy = TRUE;
+    numPending = 1;
     kernel->interrupt->Schedule(this, ConsoleTime, ConsoleWriteInt);
 }
+
+//----------------------------------------------------------------------
+// ConsoleOutput::PutBuffer()
+// 	Write "size" characters to the simulated display with a single
+//	host write, and schedule one interrupt for when the serial line
+//	would have sent them all: they take as long as if they were put
+//	one at a time.
+//----------------------------------------------------------------------
+
+void ConsoleOutput::PutBuffer(char *buffer, int size) {
+    ASSERT(putBusy == FALSE && size > 0);
+    WriteFile(writeFileNo, buffer, size);
+    putBusy = TRUE;
+    numPending = size;
+    kernel->interrupt->Schedule(this, ConsoleTime * size, ConsoleWriteInt);
+}
@@ -50,8 +50,9 @@ class ConsoleInput : public CallBackObj {
     // initialize hardware console input
     ~ConsoleInput();  // clean up console emulation
 
-    char GetChar();  // Poll the console input.  If a char is
-                     // available, return it.  Otherwise, return EOF.
+    int GetChar();  // Poll the console input.  If a char is
+                    // available, return it (as an unsigned char,
+                    // so 0xff is not EOF).  Otherwise, return EOF.
                      // "callWhenAvail" is called whenever there is
                      // a char to be gotten
 
@@ -62,7 +63,7 @@ class ConsoleInput : public CallBackObj {
     int readFileNo;              // UNIX file emulating the keyboard
     CallBackObj *callWhenAvail;  // Interrupt handler to call when
                                  // there is a char to be read
-    char incoming;               // Contains the character to be read,
+    int incoming;                // Contains the character to be read,
                                  // if there is one available.
                                  // Otherwise contains EOF.
 };
@@ -76,6 +77,10 @@ class ConsoleOutput : public CallBackObj {
     void PutChar(char ch);  // Write "ch" to the console display,
                             // and return immediately.  "callWhenDone"
                             // will called when the I/O completes.
+    void PutBuffer(char *buffer, int size);
+    // Write "size" characters at once;
+    // "callWhenDone" is called once, when
+    // the last of them is out.
     void CallBack();        // Invoked when next character can be put
                             // out to the display.
     void PutInt(int n);     // Write n to the console display
@@ -86,6 +91,7 @@ class ConsoleOutput : public CallBackObj {
                                 // the next char can be put
     bool putBusy;               // Is a PutChar operation in progress?
                                 // If so, you can't do another one!
+    int numPending;             // characters being put
 };
 
 #endif  // CONSOLE_H
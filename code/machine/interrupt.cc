@@ -24,6 +24,7 @@
 
 #include "copyright.h"
 #include "main.h"
+#include "synch.h"
 
 // String definitions for debugging messages
 
@@ -47,22 +48,22 @@ PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt,
     callOnInterrupt = callOnInt;
     when = time;
     type = kind;
+    sequence = 0;
+    heapIndex = -1;
+    nextFree = NULL;
 }
 
 //----------------------------------------------------------------------
-// PendingCompare
-//	Compare to interrupts based on which should occur first.
+// Interrupt::Earlier
+//	Return TRUE if interrupt "x" should occur before "y": it is due
+//	earlier, or at the same time but was scheduled first.
 //----------------------------------------------------------------------
 
-static int
-PendingCompare(PendingInterrupt *x, PendingInterrupt *y) {
-    if (x->when < y->when) {
-        return -1;
-    } else if (x->when > y->when) {
-        return 1;
-    } else {
-        return 0;
+bool Interrupt::Earlier(PendingInterrupt *x, PendingInterrupt *y) {
+    if (x->when != y->when) {
+        return x->when < y->when;
     }
+    return x->sequence < y->sequence;
 }
 
 //----------------------------------------------------------------------
@@ -74,7 +75,11 @@ PendingCompare(PendingInterrupt *x, PendingInterrupt *y) {
 
 Interrupt::Interrupt() {
     level = IntOff;
-    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    maxPending = 16;  // grows as needed
+    pending = new PendingInterrupt *[maxPending];
+    numPending = 0;
+    nextSequence = 0;
+    freePool = NULL;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -86,10 +91,15 @@ Interrupt::Interrupt() {
 //----------------------------------------------------------------------
 
 Interrupt::~Interrupt() {
-    while (!pending->IsEmpty()) {
-        delete pending->RemoveFront();
+    for (int i = 0; i < numPending; i++) {
+        delete pending[i];
+    }
+    delete[] pending;
+    while (freePool != NULL) {
+        PendingInterrupt *next = freePool->nextFree;
+        delete freePool;
+        freePool = next;
     }
-    delete pending;
 }
 
 //----------------------------------------------------------------------
@@ -167,6 +177,9 @@ void Interrupt::OneTick() {
         yieldOnReturn = FALSE;
         status = SystemMode;  // yield is a kernel routine
         kernel->currentThread->Yield();
+        if (oldStatus == UserMode) {
+            kernel->currentThread->CheckExiting();
+        }
         status = oldStatus;
     }
 }
@@ -230,7 +243,12 @@ void Interrupt::Halt() {
     cout << "Machine halting!\n\n";
     cout << "This is halt\n";
     kernel->stats->Print();
+    Thread::PrintPoolStats();
 #endif
+#ifdef LOCK_STATS
+    Lock::PrintStats();
+#endif
+    kernel->syscallStats->Print();  // if -ss was given
     delete kernel;  // Never returns.
 }
 /*
@@ -276,7 +294,12 @@ Interrupt::CloseFile(OpenFileId id)
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: take a PendingInterrupt from the free pool (or
+//	allocate one if the pool is empty) and push it on a binary heap,
+//	which is O(log n).
+//
+//	Returns the scheduled interrupt, which can be passed to Cancel()
+//	until it occurs.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -286,14 +309,121 @@ Interrupt::CloseFile(OpenFileId id)
 //		 interrupt is to occur
 //	"type" is the hardware device that generated the interrupt
 //----------------------------------------------------------------------
-void Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type) {
+PendingInterrupt *
+Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type) {
     int when = kernel->stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type);
+    PendingInterrupt *toOccur;
 
     DEBUG(dbgInt, "Scheduling interrupt handler the " << intTypeNames[type] << " at time = " << when);
     ASSERT(fromNow > 0);
 
-    pending->Insert(toOccur);
+    if (freePool != NULL) {
+        toOccur = freePool;
+        freePool = toOccur->nextFree;
+        toOccur->callOnInterrupt = toCall;
+        toOccur->when = when;
+        toOccur->type = type;
+        toOccur->nextFree = NULL;
+    } else {
+        toOccur = new PendingInterrupt(toCall, when, type);
+    }
+    toOccur->sequence = nextSequence++;
+
+    if (numPending == maxPending) {  // heap is full, double it
+        PendingInterrupt **larger = new PendingInterrupt *[maxPending * 2];
+        for (int i = 0; i < numPending; i++) {
+            larger[i] = pending[i];
+        }
+        delete[] pending;
+        pending = larger;
+        maxPending *= 2;
+    }
+    Place(toOccur, numPending++);
+    SiftUp(toOccur->heapIndex);
+    return toOccur;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+// 	Remove an interrupt that was scheduled, but has not occurred
+//	yet, in O(log n).  Returns FALSE if it is no longer pending.
+//
+//	"toCancel" is the value returned by Schedule()
+//----------------------------------------------------------------------
+bool Interrupt::Cancel(PendingInterrupt *toCancel) {
+    int index = toCancel->heapIndex;
+
+    if (index < 0 || index >= numPending || pending[index] != toCancel) {
+        return FALSE;
+    }
+    DEBUG(dbgInt, "Canceling interrupt handler the " << intTypeNames[toCancel->type] << " at time = " << toCancel->when);
+    Release(RemoveAt(index));
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Place, SiftUp, SiftDown, RemoveAt, Release
+// 	Maintain the heap of pending interrupts: pending[0] is the next
+//	to occur, and each entry occurs no later than its two children
+//	pending[2i+1] and pending[2i+2].  Each interrupt remembers its
+//	index, so that it can be canceled without a search.
+//----------------------------------------------------------------------
+void Interrupt::Place(PendingInterrupt *toPlace, int index) {
+    pending[index] = toPlace;
+    toPlace->heapIndex = index;
+}
+
+void Interrupt::SiftUp(int index) {
+    PendingInterrupt *item = pending[index];
+
+    while (index > 0 && Earlier(item, pending[(index - 1) / 2])) {
+        Place(pending[(index - 1) / 2], index);
+        index = (index - 1) / 2;
+    }
+    Place(item, index);
+}
+
+void Interrupt::SiftDown(int index) {
+    PendingInterrupt *item = pending[index];
+
+    for (;;) {
+        int child = 2 * index + 1;
+        if (child >= numPending) {
+            break;
+        }
+        if (child + 1 < numPending && Earlier(pending[child + 1], pending[child])) {
+            child++;
+        }
+        if (!Earlier(pending[child], item)) {
+            break;
+        }
+        Place(pending[child], index);
+        index = child;
+    }
+    Place(item, index);
+}
+
+PendingInterrupt *
+Interrupt::RemoveAt(int index) {
+    PendingInterrupt *removed = pending[index];
+
+    numPending--;
+    if (index < numPending) {  // fill the hole with the last entry
+        Place(pending[numPending], index);
+        if (index > 0 && Earlier(pending[index], pending[(index - 1) / 2])) {
+            SiftUp(index);
+        } else {
+            SiftDown(index);
+        }
+    }
+    removed->heapIndex = -1;
+    return removed;
+}
+
+void Interrupt::Release(PendingInterrupt *done) {
+    done->callOnInterrupt = NULL;
+    done->nextFree = freePool;
+    freePool = done;
 }
 
 //----------------------------------------------------------------------
@@ -317,10 +447,10 @@ bool Interrupt::CheckIfDue(bool advanceClock) {
     if (debug->IsEnabled(dbgInt)) {
         DumpState();
     }
-    if (pending->IsEmpty()) {  // no pending interrupts
+    if (numPending == 0) {  // no pending interrupts
         return FALSE;
     }
-    next = pending->Front();
+    next = pending[0];
 
     if (next->when > stats->totalTicks) {
         if (!advanceClock) {  // not time yet
@@ -341,12 +471,12 @@ bool Interrupt::CheckIfDue(bool advanceClock) {
 
     inHandler = TRUE;
     do {
-        next = pending->RemoveFront();  // pull interrupt off list
+        next = RemoveAt(0);  // pull interrupt off the heap
         DEBUG(dbgTraCode, "In Interrupt::CheckIfDue, into callOnInterrupt->CallBack, " << stats->totalTicks);
         next->callOnInterrupt->CallBack();  // call the interrupt handler
         DEBUG(dbgTraCode, "In Interrupt::CheckIfDue, return from callOnInterrupt->CallBack, " << stats->totalTicks);
-        delete next;
-    } while (!pending->IsEmpty() && (pending->Front()->when <= stats->totalTicks));
+        Release(next);
+    } while (numPending > 0 && (pending[0]->when <= stats->totalTicks));
     inHandler = FALSE;
     return TRUE;
 }
@@ -372,7 +502,10 @@ PrintPending(PendingInterrupt *pending) {
 void Interrupt::DumpState() {
     cout << "Time: " << kernel->stats->totalTicks;
     cout << ", interrupts " << intLevelNames[level] << "\n";
-    cout << "Pending interrupts:\n";
-    pending->Apply(PrintPending);
+    cout << "Pending interrupts (heap order):\n";
+    for (int i = 0; i < numPending; i++) {
+        PrintPending(pending[i]);
+        cout << "\n";
+    }
     cout << "\nEnd of pending interrupts\n";
 }
@@ -61,6 +61,10 @@ enum IntType { TimerInt,
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
 // left public to make it simpler to manipulate.
+//
+// PendingInterrupts are recycled by the Interrupt object; a pointer
+// returned by Interrupt::Schedule is only valid until the interrupt
+// fires or is canceled.
 
 typedef int OpenFileId;
 
@@ -75,6 +79,11 @@ class PendingInterrupt {
 
     int when;      // When the interrupt is supposed to fire
     IntType type;  // for debugging
+
+    unsigned int sequence;  // order of scheduling; interrupts with
+                            // equal "when" fire first come, first served
+    int heapIndex;          // position in the pending heap, or -1
+    PendingInterrupt *nextFree;  // link in the free pool
 };
 
 // The following class defines the data structures for the simulation
@@ -125,18 +134,25 @@ class Interrupt {
     // but they need to be public since they are called by the
     // hardware device simulators.
 
-    void Schedule(CallBackObj *callTo, int when, IntType type);
+    PendingInterrupt *Schedule(CallBackObj *callTo, int when, IntType type);
     // Schedule an interrupt to occur
     // at time "when".  This is called
     // by the hardware device simulators.
+    bool Cancel(PendingInterrupt *toCancel);
+    // Unschedule an interrupt that
+    // has not occurred yet.
 
     void OneTick();  // Advance simulated time
 
    private:
     IntStatus level;  // are interrupts enabled or disabled?
-    SortedList<PendingInterrupt *> *pending;
-    // the list of interrupts scheduled
-    // to occur in the future
+    PendingInterrupt **pending;  // binary min-heap of the interrupts
+                                 // scheduled to occur in the future,
+                                 // ordered by (when, sequence)
+    int numPending;              // number of interrupts in the heap
+    int maxPending;              // size of the "pending" array
+    unsigned int nextSequence;   // sequence number of next Schedule
+    PendingInterrupt *freePool;  // recycled PendingInterrupts
     // int writeFileNo;            //UNIX file emulating the display
     bool inHandler;  // TRUE if we are running an interrupt handler
     // bool putBusy;               // Is a PrintInt operation in progress
@@ -153,6 +169,14 @@ class Interrupt {
 
     void ChangeLevel(IntStatus old,   // SetLevel, without advancing the
                      IntStatus now);  // simulated time
+
+    // pending heap maintenance
+    static bool Earlier(PendingInterrupt *x, PendingInterrupt *y);
+    void Place(PendingInterrupt *toPlace, int index);
+    void SiftUp(int index);
+    void SiftDown(int index);
+    PendingInterrupt *RemoveAt(int index);  // take out of the heap
+    void Release(PendingInterrupt *done);   // return to the free pool
 };
 
 #endif  // INTERRRUPT_H
@@ -96,6 +96,9 @@ Machine::~Machine() {
 
 void Machine::RaiseException(ExceptionType which, int badVAddr) {
     DEBUG(dbgMach, "Exception: " << exceptionNames[which]);
+    if (which == PageFaultException) {
+        kernel->stats->numPageFaults++;
+    }
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);  // finish anything in progress
     kernel->interrupt->setStatus(SystemMode);
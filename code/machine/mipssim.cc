@@ -683,6 +683,7 @@ void Machine::OneInstruction(Instruction *instr) {
     }
 
     // Now we have successfully executed the instruction.
+    kernel->stats->numInstructions++;
 
     // Do any delayed load operation
     DelayedLoad(nextLoadReg, nextLoadValue);
@@ -19,9 +19,13 @@
 
 Statistics::Statistics() {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
+    numInstructions = 0;
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numDeadlineMisses = numBudgetOverruns = 0;
+    numPriorityInversions = numContextSwitches = 0;
+    numPipeBytesCopied = numPipePagesRemapped = 0;
 }
 
 //----------------------------------------------------------------------
@@ -33,6 +37,7 @@ Statistics::Statistics() {
 void Statistics::Print() {
     cout << "Ticks: total " << totalTicks << ", idle " << idleTicks;
     cout << ", system " << systemTicks << ", user " << userTicks << "\n";
+    cout << "Instructions: user " << numInstructions << "\n";
     cout << "Disk I/O: reads " << numDiskReads;
     cout << ", writes " << numDiskWrites << "\n";
     cout << "Console I/O: reads " << numConsoleCharsRead;
@@ -40,4 +45,10 @@ void Statistics::Print() {
     cout << "Paging: faults " << numPageFaults << "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
     cout << ", sent " << numPacketsSent << "\n";
+    cout << "Real-time: deadline misses " << numDeadlineMisses;
+    cout << ", budget overruns " << numBudgetOverruns << "\n";
+    cout << "Locks: priority inversions " << numPriorityInversions << "\n";
+    cout << "Scheduler: context switches " << numContextSwitches << "\n";
+    cout << "Pipes: bytes copied " << numPipeBytesCopied;
+    cout << ", pages remapped " << numPipePagesRemapped << "\n";
 }
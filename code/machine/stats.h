@@ -27,6 +27,8 @@ class Statistics {
     int userTicks;    // Time spent executing user code
                       // (this is also equal to # of
                       // user instructions executed)
+    int numInstructions;  // user instructions completed (not
+                          // cut short by an exception)
 
     int numDiskReads;            // number of disk read requests
     int numDiskWrites;           // number of disk write requests
@@ -35,6 +37,12 @@ class Statistics {
     int numPageFaults;           // number of virtual memory page faults
     int numPacketsSent;          // number of packets sent over the network
     int numPacketsRecvd;         // number of packets received over the network
+    int numDeadlineMisses;       // real-time jobs that missed their deadline
+    int numBudgetOverruns;       // real-time jobs that used up their budget
+    int numPriorityInversions;   // lock waits behind a lower-priority holder
+    int numContextSwitches;      // number of thread switches (SWITCH calls)
+    int numPipeBytesCopied;      // bytes copied into and out of pipes
+    int numPipePagesRemapped;    // pipe pages moved by remapping frames
 
     Statistics();  // initialize everything to zero
 
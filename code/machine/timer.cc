@@ -40,6 +40,8 @@ Timer::Timer(bool doRandom, CallBackObj *toCall) {
     randomize = doRandom;
     callPeriodically = toCall;
     disable = FALSE;
+    armed = FALSE;
+    lastTick = kernel->stats->totalTicks;
     SetInterrupt();
 }
 
@@ -50,6 +52,9 @@ Timer::Timer(bool doRandom, CallBackObj *toCall) {
 //	interrupt handler.
 //----------------------------------------------------------------------
 void Timer::CallBack() {
+    armed = FALSE;
+    lastTick = kernel->stats->totalTicks;
+
     // invoke the Nachos interrupt handler for this device
     callPeriodically->CallBack();
 
@@ -57,6 +62,21 @@ void Timer::CallBack() {
                      // decide if it wants to disable future interrupts
 }
 
+//----------------------------------------------------------------------
+// Timer::Enable
+//      Turn the timer device back on after it was disabled.  If no
+//	interrupt is outstanding, schedule one on the same TimerTicks
+//	grid the device would have followed had it never been stopped,
+//	so re-arming does not shift the time slice boundaries.
+//----------------------------------------------------------------------
+
+void Timer::Enable() {
+    disable = FALSE;
+    if (!armed) {
+        SetInterrupt();
+    }
+}
+
 //----------------------------------------------------------------------
 // Timer::SetInterrupt
 //      Cause a timer interrupt to occur in the future, unless
@@ -66,12 +86,13 @@ void Timer::CallBack() {
 
 void Timer::SetInterrupt() {
     if (!disable) {
-        int delay = TimerTicks;
+        int delay = TimerTicks - (kernel->stats->totalTicks - lastTick) % TimerTicks;
 
         if (randomize) {
             delay = 1 + (RandomNumber() % (TimerTicks * 2));
         }
         // schedule the next timer device interrupt
         kernel->interrupt->Schedule(this, delay, TimerInt);
+        armed = TRUE;
     }
 }
@@ -35,12 +35,17 @@ class Timer : public CallBackObj {
     void Disable() { disable = TRUE; }
     // Turn timer device off, so it doesn't
     // generate any more interrupts.
+    void Enable();  // Turn a disabled timer back on; the
+                    // next interrupt keeps the original phase
+    bool IsEnabled() { return !disable; }
 
    private:
     bool randomize;                 // set if we need to use a random timeout delay
     CallBackObj *callPeriodically;  // call this every TimerTicks time units
     bool disable;                   // turn off the timer device after next
                                     // interrupt.
+    bool armed;                     // is an interrupt currently scheduled?
+    int lastTick;                   // when the last interrupt occurred
 
     void CallBack();  // called internally when the hardware
                       // timer generates an interrupt
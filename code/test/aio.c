@@ -0,0 +1,78 @@
+/* aio.c
+ *	Queue a batch of writes, then a batch of reads, on an IoRing,
+ *	each handed to the kernel with a single IoEnter, to test
+ *	asynchronous I/O.
+ */
+
+#include "syscall.h"
+
+#define NumBlocks 8
+#define BlockSize 32
+
+IoRing ring;
+char blocks[NumBlocks][BlockSize];
+
+/* Queue one request on the submission ring. */
+void Queue(int opcode, OpenFileId fid, int block) {
+    IoSubmission *sqe = &ring.sq[ring.sqTail % IoRingEntries];
+
+    sqe->opcode = opcode;
+    sqe->fd = fid;
+    sqe->buffer = blocks[block];
+    sqe->size = BlockSize;
+    sqe->offset = block * BlockSize;
+    sqe->userData = block;
+    ring.sqTail++;
+}
+
+/* Check the results of a batch, in whatever order they completed. */
+void Reap(int count) {
+    IoCompletion *cqe;
+
+    while (count-- > 0) {
+        if (ring.cqHead == ring.cqTail)
+            MSG("Failed on waiting for completions");
+        cqe = &ring.cq[ring.cqHead % IoRingEntries];
+        if (cqe->result != BlockSize)
+            MSG("Failed on a request");
+        ring.cqHead++;
+    }
+}
+
+int main(void) {
+    OpenFileId fid;
+    int i, j;
+
+    if (Create("aio.test") != 1)
+        MSG("Failed on creating file");
+    fid = Open("aio.test");
+    if (fid < 0)
+        MSG("Failed on opening file");
+    if (IoSetup(&ring) != 0)
+        MSG("Failed on setting up the ring");
+
+    for (i = 0; i < NumBlocks; i++) {
+        for (j = 0; j < BlockSize; j++)
+            blocks[i][j] = 'a' + i;
+        Queue(IoWrite, fid, i);
+    }
+    if (IoEnter(NumBlocks, NumBlocks) != NumBlocks) /* one trap */
+        MSG("Failed on submitting writes");
+    Reap(NumBlocks);
+
+    for (i = 0; i < NumBlocks; i++) {
+        blocks[i][0] = 0;
+        Queue(IoRead, fid, i);
+    }
+    if (IoEnter(NumBlocks, NumBlocks) != NumBlocks)
+        MSG("Failed on submitting reads");
+    Reap(NumBlocks);
+    for (i = 0; i < NumBlocks; i++)
+        if (blocks[i][0] != 'a' + i || blocks[i][BlockSize - 1] != 'a' + i)
+            MSG("Failed on reading back a block");
+
+    if (Close(fid) != 1)
+        MSG("Failed on closing file");
+    MSG("Success on aio.test");
+    Halt();
+}
@@ -0,0 +1,27 @@
+/* console.c
+ *	Write a buffer several output chunks long to the console with a
+ *	single Write, and check that each console descriptor only goes
+ *	one way.
+ */
+
+#include "syscall.h"
+
+#define LineLength 64
+#define NumLines 8
+
+char text[NumLines * LineLength];
+
+int main(void) {
+    int i;
+
+    for (i = 0; i < NumLines * LineLength; i++)
+        text[i] = (i % LineLength == LineLength - 1) ? '\n' : 'a' + i / LineLength;
+    if (Write(text, sizeof(text), SysConsoleOutput) != sizeof(text))
+        MSG("Failed on writing to the console");
+    if (Write(text, 1, SysConsoleInput) >= 0)
+        MSG("Failed on refusing to write to console input");
+    if (Read(text, 1, SysConsoleOutput) >= 0)
+        MSG("Failed on refusing to read console output");
+    MSG("Success on console test");
+    Halt();
+}
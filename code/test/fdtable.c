@@ -0,0 +1,42 @@
+/* fdtable.c
+ *	Open more files than fit in a new descriptor table, and check
+ *	that descriptors are handed out lowest first, and reused once
+ *	closed.
+ */
+
+#include "syscall.h"
+
+#define NumFiles 40 /* more than the table starts with */
+#define FirstFd 2   /* after the console's */
+
+int main(void) {
+    OpenFileId fds[NumFiles];
+    char c;
+    int i;
+
+    if (Create("fdtable.test") != 1)
+        MSG("Failed on creating file");
+    for (i = 0; i < NumFiles; i++) {
+        fds[i] = Open("fdtable.test");
+        if (fds[i] != FirstFd + i)
+            MSG("Failed on opening the lowest free descriptor");
+    }
+
+    if (Close(fds[5]) != 1 || Close(fds[30]) != 1)
+        MSG("Failed on closing files");
+    if (Open("fdtable.test") != fds[5] || Open("fdtable.test") != fds[30])
+        MSG("Failed on reusing closed descriptors");
+    if (Close(fds[5]) != 1 || Close(fds[5]) == 1)
+        MSG("Failed on closing a file twice");
+    if (Read(&c, 1, fds[5]) >= 0)
+        MSG("Failed on reading a closed descriptor");
+
+    for (i = 0; i < NumFiles; i++)
+        if (i != 5)
+            Close(fds[i]);
+    if (Open("fdtable.test") != FirstFd)
+        MSG("Failed on reopening after closing everything");
+
+    MSG("Success on fdtable test");
+    Halt();
+}
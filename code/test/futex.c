@@ -0,0 +1,84 @@
+/* futex.c
+ *	Exercise the user-level mutex and condition variable.  The first
+ *	part is not contended, so it should not trap to the kernel; run
+ *	with -d u to check that the only system calls up to the first
+ *	ThreadFork are SetAtomicRegion, the FutexWait probe and PrintInt.
+ *	Then threads fight over the mutex, yielding while they hold it,
+ *	so that they have to sleep in FutexWait and be woken.
+ */
+
+#include "syscall.h"
+#include "usync.h"
+
+#define Workers 3
+#define Rounds 100
+
+Mutex mutex;
+Condition cond;
+int shared;     /* only changed with the mutex held */
+int contended;  /* a holder saw a waiter */
+int flag;       /* set by Waker */
+int woken;      /* what its FutexWake returned */
+
+void Worker() {
+    int i;
+
+    for (i = 0; i < Rounds; i++) {
+        MutexLock(&mutex);
+        shared++;
+        ThreadYield(); /* let the others find the mutex held */
+        if (mutex.state == 2)
+            contended = 1;
+        MutexUnlock(&mutex);
+    }
+}
+
+void Waker() {
+    int i;
+
+    for (i = 0; i < 10; i++)
+        ThreadYield(); /* main is asleep by now */
+    flag = 1;
+    woken = FutexWake(&flag, 1);
+}
+
+int main() {
+    ThreadId workers[Workers], waker;
+    int i, counter = 0;
+
+    MutexInit(&mutex);
+    ConditionInit(&cond);
+    for (i = 0; i < 1000; i++) {
+        MutexLock(&mutex);
+        counter++;
+        ConditionSignal(&cond); /* nobody waiting: no system call */
+        MutexUnlock(&mutex);
+    }
+    PrintInt(counter);
+
+    MutexLock(&mutex);
+    if (MutexTryLock(&mutex))
+        MSG("TryLock took a held mutex");
+    MutexUnlock(&mutex);
+
+    /* the word is not 1, so this must return at once */
+    PrintInt(FutexWait(&counter, 1));
+
+    for (i = 0; i < Workers; i++)
+        workers[i] = ThreadFork(Worker);
+    for (i = 0; i < Workers; i++)
+        ThreadJoin(workers[i]);
+    if (shared != Workers * Rounds)
+        MSG("Failed on counting under a contended mutex");
+    if (!contended)
+        MSG("Failed on contending for the mutex");
+
+    waker = ThreadFork(Waker);
+    while (flag == 0)
+        FutexWait(&flag, 0);
+    ThreadJoin(waker);
+    if (woken == 0)
+        MSG("Failed on waking a futex waiter");
+    MSG("Success on futex test");
+    return 0;
+}
@@ -0,0 +1,52 @@
+/* pipe.c
+ *	Send a short message, then whole pages, through a pipe, to test
+ *	both the copying and the page remapping paths.  Pages written
+ *	are shared with the pipe copy-on-write, so the writer keeps its
+ *	data, and changing it afterwards doesn't change what is read.
+ */
+
+#include "syscall.h"
+
+#define PageSize 128 /* must match machine.h */
+#define NumPages 4
+
+char out[NumPages * PageSize] __attribute__((aligned(PageSize)));
+char in[NumPages * PageSize] __attribute__((aligned(PageSize)));
+
+int main(void) {
+    OpenFileId fds[2];
+    char message[6];
+    int i;
+
+    if (Pipe(fds) != 0)
+        MSG("Failed on creating pipe");
+
+    if (Write("hello", 6, fds[1]) != 6)
+        MSG("Failed on writing message");
+    if (Read(message, 6, fds[0]) != 6 || message[0] != 'h' || message[5] != '\0')
+        MSG("Failed on reading message");
+
+    for (i = 0; i < NumPages * PageSize; i++)
+        out[i] = 'a' + i / PageSize;
+    if (Write(out, NumPages * PageSize, fds[1]) != NumPages * PageSize)
+        MSG("Failed on writing pages");
+    for (i = 0; i < NumPages; i++)
+        if (out[i * PageSize] != 'a' + i) /* shared with the pipe, not taken */
+            MSG("Failed on keeping written pages");
+    for (i = 0; i < NumPages * PageSize; i++)
+        out[i] = 'z'; /* copied on write; the pipe still has the old data */
+    if (Read(in, NumPages * PageSize, fds[0]) != NumPages * PageSize)
+        MSG("Failed on reading pages");
+    for (i = 0; i < NumPages; i++)
+        if (in[i * PageSize] != 'a' + i || in[i * PageSize + PageSize - 1] != 'a' + i)
+            MSG("Failed on checking pages");
+
+    if (Close(fds[1]) != 1)
+        MSG("Failed on closing write end");
+    if (Read(message, 6, fds[0]) != 0) /* end of file */
+        MSG("Failed on reading end of file");
+    if (Close(fds[0]) != 1)
+        MSG("Failed on closing read end");
+    MSG("Success on pipe test");
+    Halt();
+}
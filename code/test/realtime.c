@@ -0,0 +1,62 @@
+/* realtime.c
+ *	Check the real-time scheduler: requests it cannot meet are
+ *	refused, a real-time thread runs ahead of the others while it
+ *	has budget, and is held back once the budget for its period is
+ *	used up, so the others get the rest of the period.
+ */
+
+#include "syscall.h"
+
+#define Period 2000
+#define Budget 500
+
+int started;   /* the spinner is real-time */
+int stop;      /* ... and can stop now */
+int spins;
+int rtStart;   /* when it became real-time */
+
+int Now() {
+    RUsage usage;
+
+    GetRUsage(&usage);
+    return usage.elapsedTicks;
+}
+
+/* Spin, never blocking, until told to stop. */
+void Spinner() {
+    if (SetRealTime(Period, Budget, Period) != 0)
+        ThreadExit(1);
+    rtStart = Now();
+    started = 1;
+    while (!stop)
+        spins++;
+}
+
+int main(void) {
+    ThreadId spinner;
+    int ran;
+
+    if (SetRealTime(Period, Budget, Budget - 1) >= 0 ||
+        SetRealTime(Period, Budget, Period + 1) >= 0 ||
+        SetRealTime(0, 0, 0) >= 0)
+        MSG("Failed on refusing bad parameters");
+
+    spinner = ThreadFork(Spinner);
+    while (!started) /* it only lets us back in once held back */
+        ThreadYield();
+    ran = Now() - rtStart;
+    if (ran < Budget / 2)
+        MSG("Failed on running the real-time thread first");
+    if (ran >= Period)
+        MSG("Failed on holding back a thread over its budget");
+    if (SetRealTime(Period, Period, Period) >= 0)
+        MSG("Failed on refusing more than the whole CPU");
+
+    stop = 1;
+    if (ThreadJoin(spinner) != 0 || spins == 0)
+        MSG("Failed on running the real-time thread");
+    if (SetRealTime(Period, Period, Period) != 0) /* its share is free */
+        MSG("Failed on admitting a real-time thread");
+    MSG("Success on realtime test");
+    Halt();
+}
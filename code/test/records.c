@@ -0,0 +1,56 @@
+/* records.c
+ *	Write fixed-size records of several fields with one WriteV each,
+ *	then read some back with PRead and ReadV, to test vectored and
+ *	positional I/O.
+ */
+
+#include "syscall.h"
+
+#define NumRecords 10
+#define RecordSize 12
+
+int main(void) {
+    char key[4], name[6], nl[2];
+    char buffer[RecordSize];
+    IoVec iov[3];
+    OpenFileId fid;
+    int i;
+
+    if (Create("records.test") != 1)
+        MSG("Failed on creating file");
+    fid = Open("records.test");
+    if (fid < 0)
+        MSG("Failed on opening file");
+
+    iov[0].base = key;
+    iov[0].length = 4;
+    iov[1].base = name;
+    iov[1].length = 6;
+    iov[2].base = nl;
+    iov[2].length = 2;
+    for (i = 0; i < 6; i++)
+        name[i] = "record"[i];
+    nl[0] = ';';
+    nl[1] = '\n';
+    for (i = 0; i < NumRecords; i++) {
+        key[0] = key[1] = key[2] = '0';
+        key[3] = '0' + i;
+        if (WriteV(iov, 3, fid) != RecordSize) /* one trap per record */
+            MSG("Failed on writing record");
+    }
+
+    /* record 7, without moving the seek position */
+    if (PRead(buffer, RecordSize, 7 * RecordSize, fid) != RecordSize || buffer[3] != '7')
+        MSG("Failed on reading record 7");
+
+    /* record 2, field by field */
+    if (Seek(2 * RecordSize, fid) != 2 * RecordSize)
+        MSG("Failed on seeking");
+    if (ReadV(iov, 3, fid) != RecordSize || key[3] != '2' || name[0] != 'r')
+        MSG("Failed on reading record 2");
+
+    if (Close(fid) != 1)
+        MSG("Failed on closing file");
+    MSG("Success on records.test");
+    Halt();
+}
@@ -0,0 +1,42 @@
+/* rusage.c
+ *	Time a phase of work with GetRUsage, the way a benchmark would
+ *	report its own cost, and check that the characters we write to
+ *	the console are charged to us.
+ */
+
+#include "syscall.h"
+
+#define Loops 1000
+#define Line "rusage: writing a line\n"
+#define LineSize 23
+
+int main(void) {
+    RUsage before, after;
+    int i, sum = 0;
+
+    if (GetRUsage(&before) != 0)
+        MSG("Failed on getting resource usage");
+    for (i = 0; i < Loops; i++)
+        sum += i;
+    if (GetRUsage(&after) != 0)
+        MSG("Failed on getting resource usage");
+
+    /* each iteration takes several instructions, each one tick */
+    if (after.instructions - before.instructions < Loops ||
+        after.userTicks - before.userTicks < Loops)
+        MSG("Failed on counting instructions");
+    if (after.systemTicks <= before.systemTicks) /* the call itself */
+        MSG("Failed on counting system ticks");
+    PrintInt(after.instructions - before.instructions);
+    PrintInt(after.userTicks - before.userTicks);
+
+    GetRUsage(&before);
+    Write(Line, LineSize, SysConsoleOutput);
+    GetRUsage(&after);
+    if (after.consoleCharsWritten - before.consoleCharsWritten != LineSize)
+        MSG("Failed on counting console characters written");
+    if (GetRUsage((RUsage *)0x7ffffff0) >= 0)
+        MSG("Failed on refusing a bad address");
+    MSG("Success on rusage test");
+    Halt();
+}
@@ -0,0 +1,73 @@
+/* shm.c
+ *	Attach a shared memory segment at two addresses, and check that
+ *	what is written through one is read through the other.  Then
+ *	start a copy of this program with ExecV, passing it the id, and
+ *	check that the two processes see the same memory.
+ */
+
+#include "syscall.h"
+
+#define SegmentSize 256
+#define Where ((char *)0x10000)
+
+int main(int argc, char **argv) {
+    char *first, *second;
+    char *args[3];
+    char digits[3];
+    SpaceId child;
+    int id, i;
+
+    if (argc == 3) { /* a child: answer through the segment */
+        id = 0;
+        for (i = 0; argv[2][i] != '\0'; i++)
+            id = id * 10 + argv[2][i] - '0';
+        first = ShmAttach(id, 0);
+        if ((int)first < 0)
+            Exit(1);
+        for (i = 0; i < SegmentSize; i++)
+            if (first[i] != (char)i)
+                Exit(2);
+        first[0] = 'k';
+        Exit(ShmDetach(first) == 0 ? 0 : 3);
+    }
+
+    id = ShmCreate(SegmentSize);
+    if (id < 0)
+        MSG("Failed on creating segment");
+    first = ShmAttach(id, 0);
+    if ((int)first < 0)
+        MSG("Failed on attaching segment");
+    second = ShmAttach(id, Where);
+    if (second != Where)
+        MSG("Failed on attaching segment at an address");
+    if ((int)ShmAttach(id, Where) >= 0)
+        MSG("Failed on refusing an address in use");
+
+    for (i = 0; i < SegmentSize; i++)
+        first[i] = i;
+    for (i = 0; i < SegmentSize; i++)
+        if (second[i] != (char)i)
+            MSG("Failed on sharing memory");
+
+    args[0] = "../test/shm";
+    args[1] = "child";
+    args[2] = digits;
+    digits[0] = '0' + id / 10;
+    digits[1] = '0' + id % 10;
+    digits[2] = '\0';
+    child = ExecV(3, args);
+    if (child < 0)
+        MSG("Failed on starting child");
+    if (Join(child) != 0)
+        MSG("Failed on sharing memory with child");
+    if (second[0] != 'k')
+        MSG("Failed on reading what the child wrote");
+
+    if (ShmDetach(first) != 0 || ShmDetach(second) != 0)
+        MSG("Failed on detaching segment");
+    first = ShmAttach(id, 0); /* kept while we, its creator, live */
+    if ((int)first < 0 || first[1] != 1)
+        MSG("Failed on keeping segment");
+    MSG("Success on shm test");
+    Halt();
+}
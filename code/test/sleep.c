@@ -0,0 +1,52 @@
+/* sleep.c
+ *	Check that Sleep blocks for at least as long as asked, without
+ *	using the CPU, and that sleepers wake up in order of their
+ *	wake-up time, not of when they went to sleep.
+ */
+
+#include "syscall.h"
+
+#define Ticks 1000
+
+int woke[2];
+int numWoke;
+
+void Long() {
+    Sleep(3 * Ticks);
+    woke[numWoke++] = 2;
+}
+
+void Short() {
+    Sleep(Ticks);
+    woke[numWoke++] = 1;
+}
+
+int main(void) {
+    RUsage before, after;
+    ThreadId first, second;
+
+    GetRUsage(&before);
+    Sleep(Ticks);
+    GetRUsage(&after);
+    if (after.elapsedTicks - before.elapsedTicks < Ticks)
+        MSG("Failed on sleeping long enough");
+    if ((after.userTicks + after.systemTicks) -
+            (before.userTicks + before.systemTicks) >= Ticks)
+        MSG("Failed on sleeping without using the CPU");
+
+    GetRUsage(&before);
+    Sleep(0);
+    Sleep(-Ticks);
+    GetRUsage(&after);
+    if (after.elapsedTicks - before.elapsedTicks >= Ticks)
+        MSG("Failed on returning at once from Sleep(0)");
+
+    first = ThreadFork(Long);
+    second = ThreadFork(Short);
+    ThreadJoin(first);
+    ThreadJoin(second);
+    if (numWoke != 2 || woke[0] != 1 || woke[1] != 2)
+        MSG("Failed on waking sleepers in order");
+    MSG("Success on sleep test");
+    Halt();
+}
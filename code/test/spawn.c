@@ -0,0 +1,42 @@
+/* spawn.c
+ *	Start copies of this program with ExecV, passing each an argument
+ *	it exits with, and check that Join gets it back.  Then check
+ *	that files which are missing or not programs are refused.
+ */
+
+#include "syscall.h"
+
+#define NumChildren 3
+
+int main(int argc, char **argv) {
+    char *args[3];
+    char digit[2];
+    SpaceId children[NumChildren];
+    int i;
+
+    if (argc == 3) { /* a child: exit with the digit we were given */
+        Exit(argv[2][0] - '0');
+    }
+
+    args[0] = "../test/spawn";
+    args[1] = "child";
+    args[2] = digit;
+    digit[1] = '\0';
+    for (i = 0; i < NumChildren; i++) {
+        digit[0] = '1' + i;
+        children[i] = ExecV(3, args);
+        if (children[i] < 0)
+            MSG("Failed on starting child");
+    }
+    for (i = NumChildren - 1; i >= 0; i--)
+        if (Join(children[i]) != i + 1)
+            MSG("Failed on joining child");
+    if (Join(children[0]) >= 0)
+        MSG("Failed on refusing a child already joined");
+    if (Exec("../test/nonexistent") != ENOENT)
+        MSG("Failed on refusing a missing program");
+    if (Exec("../test/spawn.c") != ENOEXEC)
+        MSG("Failed on refusing a file which is not a program");
+    MSG("Success on spawn test");
+    Halt();
+}
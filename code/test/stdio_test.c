@@ -0,0 +1,36 @@
+/* stdio_test.c
+ *	Read the numbers in num_100.txt a line at a time through the
+ *	buffered reader, and print them back with printf: a few Reads
+ *	and Writes in all, rather than a trap per number.
+ */
+
+#include "ustdio.h"
+
+int main(void) {
+    char line[128], *p;
+    FILE *in;
+    int count = 0, sum = 0, value;
+
+    in = fopen("num_100.txt");
+    if (in == NULL)
+        MSG("Failed on opening num_100.txt");
+    while (fgets(line, sizeof(line), in) != NULL) {
+        for (p = line; *p != '\0';) {
+            if (*p < '0' || *p > '9') {
+                p++;
+                continue;
+            }
+            for (value = 0; *p >= '0' && *p <= '9'; p++)
+                value = value * 10 + *p - '0';
+            printf("%4d%c", value, ++count % 10 == 0 ? '\n' : ' ');
+            sum += value;
+        }
+    }
+    fclose(in);
+    printf("%d numbers, sum %d (0x%04x)\n", count, sum, sum);
+    fflush(stdout);
+    if (count != 100 || sum != 5050)
+        MSG("Failed on reading numbers");
+    MSG("Success on stdio test");
+    Halt();
+}
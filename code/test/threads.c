@@ -0,0 +1,118 @@
+/* threads.c
+ *	Fork threads in the same address space, each summing part of an
+ *	array on its own stack, and join them to collect the results.
+ *	Then fork more threads, one after another, than a program can
+ *	run at once; and start a copy of this program whose threads are
+ *	blocked when it exits (one of them joining a child that never
+ *	exits), to check that Exit still ends it.
+ */
+
+#include "syscall.h"
+
+#define Size 100 /* partial sums must fit in a thread stack */
+#define ManyThreads 100 /* more than MaxUserThreads in process.h */
+
+int numbers[Size];
+int sums[2];
+OpenFileId fds[2];
+ThreadId reader;
+
+/* Sum numbers[from..to-1], with the partial sums on the stack. */
+int Sum(int from, int to) {
+    int partial[Size];
+    int i;
+
+    partial[from] = numbers[from];
+    for (i = from + 1; i < to; i++) {
+        partial[i] = partial[i - 1] + numbers[i];
+        if (i % 20 == 0)
+            ThreadYield();
+    }
+    return partial[to - 1];
+}
+
+void First() {
+    sums[0] = Sum(0, Size / 2);
+    ThreadExit(1);
+}
+
+void Second() {
+    sums[1] = Sum(Size / 2, Size);
+    /* returning is the same as ThreadExit(0) */
+}
+
+void Nothing() {
+}
+
+/* In the copy: wait for bytes nobody writes. */
+void Reader() {
+    char c;
+
+    Read(&c, 1, fds[0]);
+}
+
+/* In the copy: wait for the reader. */
+void Joiner() {
+    ThreadJoin(reader);
+}
+
+/* In the copy: wait for a child stuck for good. */
+void ChildJoiner() {
+    char *args[2];
+
+    args[0] = "../test/threads";
+    args[1] = "block";
+    Join(ExecV(2, args));
+}
+
+int main(int argc, char **argv) {
+    ThreadId first, second;
+    char *args[2];
+    SpaceId child;
+    int i;
+
+    if (argc == 2 && argv[1][0] == 'b') { /* its child: never exit */
+        if (Pipe(fds) != 0)
+            Exit(1);
+        ThreadJoin(ThreadFork(Reader));
+        Exit(3);
+    }
+    if (argc == 2) { /* the copy: exit with threads blocked */
+        if (Pipe(fds) != 0)
+            Exit(1);
+        reader = ThreadFork(Reader);
+        if (reader < 0 || ThreadFork(Joiner) < 0 || ThreadFork(ChildJoiner) < 0)
+            Exit(2);
+        for (i = 0; i < 10; i++)
+            ThreadYield();
+        Exit(7);
+    }
+
+    for (i = 0; i < Size; i++)
+        numbers[i] = i;
+
+    first = ThreadFork(First);
+    second = ThreadFork(Second);
+    if (first < 0 || second < 0 || first == second)
+        MSG("Failed on forking threads");
+    if (ThreadJoin(second) != 0 || ThreadJoin(first) != 1)
+        MSG("Failed on joining threads");
+    if (ThreadJoin(first) != 1) /* every joiner gets the code */
+        MSG("Failed on joining a thread twice");
+    if (ThreadJoin(1) >= 0) /* ourselves */
+        MSG("Failed on refusing to join ourselves");
+    if (sums[0] + sums[1] != Size * (Size - 1) / 2)
+        MSG("Failed on summing in threads");
+
+    for (i = 0; i < ManyThreads; i++)
+        if (ThreadJoin(ThreadFork(Nothing)) != 0)
+            MSG("Failed on forking threads one after another");
+
+    args[0] = "../test/threads";
+    args[1] = "exit";
+    child = ExecV(2, args);
+    if (child < 0 || Join(child) != 7)
+        MSG("Failed on exiting with threads blocked");
+    MSG("Success on threads test");
+    Halt();
+}
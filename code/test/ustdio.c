@@ -0,0 +1,213 @@
+/* ustdio.c
+ *	Buffered console output and file input.  See ustdio.h.
+ */
+
+#include <stdarg.h>
+
+#include "ustdio.h"
+
+static FILE consoleIn = {SysConsoleInput, 0, 0, 0, 0};
+static FILE consoleOut = {SysConsoleOutput, 1, 0, 0, 0};
+static FILE files[MaxStdioFiles];
+static int inUse[MaxStdioFiles];
+
+FILE *stdin = &consoleIn;
+FILE *stdout = &consoleOut;
+
+static void FlushStdout(void) {
+    fflush(stdout);
+}
+
+/* called by start.S when main returns */
+void (*exitHook)(void) = FlushStdout;
+
+int fflush(FILE *stream) {
+    int done = 0, n;
+
+    if (!stream->writing)
+        return 0;
+    while (done < stream->count) {
+        n = Write(stream->buf + done, stream->count - done, stream->fd);
+        if (n <= 0) {
+            stream->count = 0;
+            return EOF;
+        }
+        done += n;
+    }
+    stream->count = 0;
+    return 0;
+}
+
+void exit(int status) {
+    fflush(stdout);
+    Exit(status);
+}
+
+int putchar(int c) {
+    if (stdout->count == StdioBufferSize && fflush(stdout) == EOF)
+        return EOF;
+    stdout->buf[stdout->count++] = c;
+    return c & 0xff;
+}
+
+int puts(char *s) {
+    while (*s != '\0')
+        putchar(*s++);
+    return putchar('\n');
+}
+
+/* Print "value" in "base", at least "width" characters wide, padded
+ * on the left with "pad".  Returns the number of characters printed.
+ */
+static int PutNumber(unsigned int value, int base, int negative,
+                     int width, char pad) {
+    char digits[12];
+    int n = 0, printed = 0;
+
+    do {
+        digits[n++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value != 0);
+    if (negative)
+        width--;
+    if (negative && pad == '0') {
+        putchar('-');
+        printed++;
+    }
+    for (; width > n; width--, printed++)
+        putchar(pad);
+    if (negative && pad != '0') {
+        putchar('-');
+        printed++;
+    }
+    while (n > 0) {
+        putchar(digits[--n]);
+        printed++;
+    }
+    return printed;
+}
+
+int printf(char *format, ...) {
+    va_list args;
+    int printed = 0, width, value;
+    char pad, *s;
+
+    va_start(args, format);
+    for (; *format != '\0'; format++) {
+        if (*format != '%') {
+            putchar(*format);
+            printed++;
+            continue;
+        }
+        format++;
+        pad = ' ';
+        if (*format == '0') {
+            pad = '0';
+            format++;
+        }
+        for (width = 0; *format >= '0' && *format <= '9'; format++)
+            width = width * 10 + *format - '0';
+        switch (*format) {
+            case 'd':
+                value = va_arg(args, int);
+                printed += PutNumber(value < 0 ? -(unsigned int)value : value, 10,
+                                     value < 0, width, pad);
+                break;
+            case 'u':
+                printed += PutNumber(va_arg(args, unsigned int), 10, 0, width, pad);
+                break;
+            case 'x':
+                printed += PutNumber(va_arg(args, unsigned int), 16, 0, width, pad);
+                break;
+            case 'c':
+                putchar(va_arg(args, int));
+                printed++;
+                break;
+            case 's':
+                for (s = va_arg(args, char *); *s != '\0'; s++, printed++)
+                    putchar(*s);
+                break;
+            case '\0':
+                format--; /* a lone '%' at the end */
+                break;
+            default: /* "%%", or something we don't know */
+                putchar(*format);
+                printed++;
+                break;
+        }
+    }
+    va_end(args);
+    return printed;
+}
+
+FILE *fopen(char *name) {
+    OpenFileId fd;
+    int i;
+
+    for (i = 0; i < MaxStdioFiles && inUse[i]; i++)
+        ;
+    if (i == MaxStdioFiles)
+        return NULL;
+    fd = Open(name);
+    if (fd < 0)
+        return NULL;
+    inUse[i] = 1;
+    files[i].fd = fd;
+    files[i].writing = 0;
+    files[i].pos = files[i].count = files[i].eof = 0;
+    return &files[i];
+}
+
+int fclose(FILE *stream) {
+    inUse[stream - files] = 0;
+    return Close(stream->fd) == 1 ? 0 : EOF;
+}
+
+/* Refill the buffer of an input stream.  Returns 0 at end of file. */
+static int Fill(FILE *stream) {
+    if (stream->eof)
+        return 0;
+    if (stream == stdin)
+        fflush(stdout); /* show the prompt first */
+    stream->pos = 0;
+    stream->count = Read(stream->buf, StdioBufferSize, stream->fd);
+    if (stream->count <= 0) {
+        stream->count = 0;
+        stream->eof = 1;
+    }
+    return stream->count;
+}
+
+int fgetc(FILE *stream) {
+    if (stream->pos == stream->count && Fill(stream) == 0)
+        return EOF;
+    return stream->buf[stream->pos++] & 0xff;
+}
+
+int getchar(void) {
+    return fgetc(stdin);
+}
+
+char *fgets(char *s, int size, FILE *stream) {
+    int n = 0, c = 0;
+
+    while (n < size - 1 && c != '\n' && (c = fgetc(stream)) != EOF)
+        s[n++] = c;
+    s[n] = '\0';
+    return n == 0 ? NULL : s;
+}
+
+int fread(char *buffer, int size, FILE *stream) {
+    int done = 0, n;
+
+    while (done < size) {
+        if (stream->pos == stream->count && Fill(stream) == 0)
+            break;
+        n = stream->count - stream->pos;
+        if (n > size - done)
+            n = size - done;
+        for (; n > 0; n--)
+            buffer[done++] = stream->buf[stream->pos++];
+    }
+    return done;
+}
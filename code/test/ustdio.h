@@ -0,0 +1,55 @@
+/* ustdio.h
+ *	Buffered console output and file input for user programs: a
+ *	small part of the C standard I/O library.
+ *
+ *	printf, puts and putchar only fill a buffer; it goes out with a
+ *	single Write to the console when it is full, when fflush or exit
+ *	is called, or when main returns, so a program printing many small
+ *	things traps once per StdioBufferSize characters rather than once
+ *	per call.  Halt and Exit do not flush: call fflush(stdout) (or
+ *	use exit) first.
+ *
+ *	Files are read a buffer at a time, and handed out a character
+ *	or a line at a time.  None of this is safe to use from several
+ *	threads at once.
+ *
+ *	Link with ustdio.o.
+ */
+
+#ifndef USTDIO_H
+#define USTDIO_H
+
+#include "syscall.h"
+
+#define StdioBufferSize 256 /* bytes per Read or Write */
+#define MaxStdioFiles 4     /* files fopen can have open at once */
+#define EOF (-1)
+#ifndef NULL
+#define NULL 0
+#endif
+
+typedef struct {
+    OpenFileId fd;
+    int writing; /* output stream? */
+    int pos;     /* next byte of "buf" to read */
+    int count;   /* bytes in "buf" */
+    int eof;     /* the last Read got nothing */
+    char buf[StdioBufferSize];
+} FILE;
+
+extern FILE *stdin, *stdout;
+
+int putchar(int c);
+int puts(char *s);
+int printf(char *format, ...); /* %d %u %x %c %s %%, with a width */
+int fflush(FILE *stream);      /* write out what stdout holds */
+void exit(int status);         /* fflush(stdout), then Exit */
+
+FILE *fopen(char *name);       /* for reading; NULL if it can't */
+int fclose(FILE *stream);
+int fgetc(FILE *stream);       /* EOF at end of file */
+char *fgets(char *s, int size, FILE *stream); /* NULL at end of file */
+int fread(char *buffer, int size, FILE *stream);
+int getchar(void);
+
+#endif /* USTDIO_H */
@@ -0,0 +1,93 @@
+/* usync.c
+ *	User-level mutexes and condition variables.  See usync.h.
+ *
+ *	The mutex follows the classic three-state futex design: a thread
+ *	that finds the mutex held marks it "contended" (2) before
+ *	sleeping, so the holder knows to call FutexWake on release.
+ */
+
+#include "usync.h"
+
+extern void AtomicBegin(), AtomicEnd();
+
+/* Register CompareAndSwap as the process's restartable sequence,
+ * once; it must be done before any thread relies on it.
+ */
+static void RegisterAtomic() {
+    static int registered = 0;
+
+    if (!registered) {
+        SetAtomicRegion((int)AtomicBegin, (int)AtomicEnd);
+        registered = 1;
+    }
+}
+
+/* Atomically store "value" at "addr", returning the old value. */
+static int Exchange(int *addr, int value) {
+    int old;
+
+    do {
+        old = *addr;
+    } while (CompareAndSwap(addr, old, value) != old);
+    return old;
+}
+
+void MutexInit(Mutex *mutex) {
+    RegisterAtomic();
+    mutex->state = 0;
+}
+
+void MutexLock(Mutex *mutex) {
+    int c = CompareAndSwap(&mutex->state, 0, 1);
+
+    if (c == 0)
+        return; /* it was free: no system call */
+    if (c != 2)
+        c = Exchange(&mutex->state, 2);
+    while (c != 0) {
+        FutexWait(&mutex->state, 2);
+        c = Exchange(&mutex->state, 2);
+    }
+}
+
+int MutexTryLock(Mutex *mutex) {
+    return CompareAndSwap(&mutex->state, 0, 1) == 0;
+}
+
+void MutexUnlock(Mutex *mutex) {
+    if (Exchange(&mutex->state, 0) == 2)
+        FutexWake(&mutex->state, 1);
+}
+
+void ConditionInit(Condition *cond) {
+    RegisterAtomic();
+    cond->sequence = 0;
+    cond->waiters = 0;
+}
+
+void ConditionWait(Condition *cond, Mutex *mutex) {
+    int sequence = cond->sequence;
+
+    cond->waiters++;
+    MutexUnlock(mutex);
+    FutexWait(&cond->sequence, sequence);
+
+    /* others may be waiting for the mutex too, so take it "contended" */
+    while (Exchange(&mutex->state, 2) != 0)
+        FutexWait(&mutex->state, 2);
+    cond->waiters--;
+}
+
+void ConditionSignal(Condition *cond) {
+    if (cond->waiters > 0) {
+        cond->sequence++;
+        FutexWake(&cond->sequence, 1);
+    }
+}
+
+void ConditionBroadcast(Condition *cond) {
+    if (cond->waiters > 0) {
+        cond->sequence++;
+        FutexWake(&cond->sequence, cond->waiters);
+    }
+}
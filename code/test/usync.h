@@ -0,0 +1,46 @@
+/* usync.h
+ *	Synchronization for user programs: mutexes and condition
+ *	variables built on CompareAndSwap and the futex system calls.
+ *
+ *	Taking a free mutex, releasing one nobody waits for, and
+ *	signalling a condition nobody waits on never trap to the kernel.
+ *
+ *	Link with usync.o.
+ */
+
+#ifndef USYNC_H
+#define USYNC_H
+
+#include "syscall.h"
+
+/* A mutex word is 0 when free, 1 when held, and 2 when held with
+ * (possibly) some thread waiting in FutexWait.
+ */
+typedef struct {
+    int state;
+} Mutex;
+
+/* "sequence" changes on every signal, so a waiter that is about to
+ * sleep notices a signal it would otherwise miss.  Both fields are
+ * only changed with the mutex held.
+ */
+typedef struct {
+    int sequence;
+    int waiters;
+} Condition;
+
+/* Atomically: if *addr == old, set *addr = new; return the old *addr */
+int CompareAndSwap(int *addr, int old, int new);
+
+void MutexInit(Mutex *mutex);
+void MutexLock(Mutex *mutex);
+int MutexTryLock(Mutex *mutex); /* 1 if taken, 0 if held by someone */
+void MutexUnlock(Mutex *mutex);
+
+/* The mutex must be held for all of these. */
+void ConditionInit(Condition *cond);
+void ConditionWait(Condition *cond, Mutex *mutex);
+void ConditionSignal(Condition *cond);
+void ConditionBroadcast(Condition *cond);
+
+#endif /* USYNC_H */
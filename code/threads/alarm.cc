@@ -1,8 +1,6 @@
 // alarm.cc
 //	Routines to use a hardware timer device to provide a
-//	software alarm clock.  For now, we just provide time-slicing.
-//
-//	Not completely implemented.
+//	software alarm clock: time-slicing, and timed waits.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -13,18 +11,54 @@
 #include "copyright.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// SleeperCompare
+//	Order sleeping threads by the time they are due to wake up.
+//----------------------------------------------------------------------
+
+static int
+SleeperCompare(Sleeper *x, Sleeper *y) {
+    if (x->when < y->when) {
+        return -1;
+    } else if (x->when > y->when) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
 //----------------------------------------------------------------------
 // Alarm::Alarm
 //      Initialize a software alarm clock.  Start up a timer device
 //
 //      "doRandom" -- if true, arrange for the hardware interrupts to
 //		occur at random, instead of fixed, intervals.
+//      "doTickless" -- if true, suspend the timer whenever the ready
+//		queues are empty (idle, or a single runnable thread).
 //----------------------------------------------------------------------
 
-Alarm::Alarm(bool doRandom) {
+Alarm::Alarm(bool doRandom, bool doTickless) {
+    tickless = doTickless;
+    sleepers = new SortedList<Sleeper *>(SleeperCompare);
+    wakeUp = NULL;
+    wakeUpTime = 0;
     timer = new Timer(doRandom, this);
 }
 
+//----------------------------------------------------------------------
+// Alarm::~Alarm
+//      De-allocate the alarm clock.  Threads still sleeping are
+//	not woken up.
+//----------------------------------------------------------------------
+
+Alarm::~Alarm() {
+    while (!sleepers->IsEmpty()) {
+        delete sleepers->RemoveFront();
+    }
+    delete sleepers;
+    delete timer;
+}
+
 //----------------------------------------------------------------------
 // Alarm::CallBack
 //	Software interrupt handler for the timer device. The timer device is
@@ -40,15 +74,133 @@ Alarm::Alarm(bool doRandom) {
 //	was interrupted.
 //
 //	For now, just provide time-slicing.  Only need to time slice
-//      if we're currently running something (in other words, not idle).
+//      if we're currently running something (in other words, not idle),
+//	and only once the running thread has used up its quantum (see
+//	Scheduler::QuantumExpired) or a higher queue level has a thread
+//	ready to preempt it.
+//
+//	Real-time (EDF) jobs are released, and their budgets enforced,
+//	here as well; see Scheduler::RealTimeTick.
+//
+//	In tickless mode, a tick that finds the ready queues empty (and
+//	no real-time threads) can neither preempt nor age anybody, and
+//	neither can any later tick until some thread becomes ready, so
+//	the timer is switched off until Resume() is called from
+//	Scheduler::ReadyToRun.
 //----------------------------------------------------------------------
 
 void Alarm::CallBack() {
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
 
+    if (tickless && !kernel->scheduler->TimerNeeded()) {
+        DEBUG(dbgInt, "Timer suspended at tick " << kernel->stats->totalTicks);
+        timer->Disable();
+        return;
+    }
+
+    Scheduler *scheduler = kernel->scheduler;
+    bool realTimeYield = scheduler->RealTimeTick();  // also when idle
+
+    WakeUp();
+
     if (status != IdleMode) {
-        interrupt->YieldOnReturn();
-        kernel->scheduler->ElevateThreads();
+        Thread *thread = kernel->currentThread;
+
+        // only switch if the slice is over or a higher level is waiting
+        if (realTimeYield || thread->getStatus() != RUNNING ||
+            scheduler->QuantumExpired(thread) || scheduler->PreemptionPending(thread)) {
+            interrupt->YieldOnReturn();
+        }
+        scheduler->ElevateThreads();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::Resume
+//	Called whenever a thread is put on the ready list.  Turn the
+//	timer back on if CallBack() suspended it; the next interrupt
+//	lands on the original time slice boundary.
+//----------------------------------------------------------------------
+
+void Alarm::Resume() {
+    if (tickless && !timer->IsEnabled()) {
+        DEBUG(dbgInt, "Timer resumed at tick " << kernel->stats->totalTicks);
+        timer->Enable();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+//	Put the current thread to sleep until at least "x" ticks from
+//	now.  The thread goes on the sorted list of sleepers, and the
+//	one-shot wake-up interrupt is moved earlier if needed.
+//
+//	"x" -- how long to sleep, in ticks
+//----------------------------------------------------------------------
+
+void Alarm::WaitUntil(int x) {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Thread *thread = kernel->currentThread;
+    int when = kernel->stats->totalTicks + x;
+
+    if (x > 0) {
+        DEBUG(dbgThread, "Thread " << thread->getName() << " sleeps until tick " << when);
+        sleepers->Insert(new Sleeper(thread, when));
+        ScheduleWakeUp();
+        thread->Sleep(FALSE);
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Alarm::WakeUp
+//	Put every sleeper whose time has come back on the ready list,
+//	and arm the wake-up interrupt for the next one.  Called with
+//	interrupts disabled, from the timer or the wake-up interrupt.
+//----------------------------------------------------------------------
+
+void Alarm::WakeUp() {
+    int now = kernel->stats->totalTicks;
+
+    while (!sleepers->IsEmpty() && sleepers->Front()->when <= now) {
+        Sleeper *sleeper = sleepers->RemoveFront();
+        DEBUG(dbgThread, "Waking up thread " << sleeper->thread->getName() << " at tick " << now);
+        kernel->scheduler->ReadyToRun(sleeper->thread);
+        delete sleeper;
     }
+    ScheduleWakeUp();
+}
+
+//----------------------------------------------------------------------
+// Alarm::ScheduleWakeUp
+//	Make sure the wake-up interrupt is set for the earliest sleeper
+//	(and not set at all if nobody sleeps).
+//----------------------------------------------------------------------
+
+void Alarm::ScheduleWakeUp() {
+    int now = kernel->stats->totalTicks;
+
+    if (wakeUp != NULL) {
+        if (!sleepers->IsEmpty() && wakeUpTime == sleepers->Front()->when) {
+            return;  // already set for the right time
+        }
+        kernel->interrupt->Cancel(wakeUp);
+        wakeUp = NULL;
+    }
+    if (!sleepers->IsEmpty()) {
+        wakeUpTime = sleepers->Front()->when;
+        wakeUp = kernel->interrupt->Schedule(&wakeUpCall,
+                                             max(wakeUpTime - now, 1), TimerInt);
+    }
+}
+
+//----------------------------------------------------------------------
+// WakeUpCall::CallBack
+//	The wake-up interrupt for the earliest sleeper has occurred.
+//----------------------------------------------------------------------
+
+void WakeUpCall::CallBack() {
+    kernel->alarm->wakeUp = NULL;  // fired; the handle is stale now
+    kernel->alarm->WakeUp();
 }
@@ -8,7 +8,11 @@
 //	From this, we provide the ability for a thread to be
 //	woken up after a delay; we also provide time-slicing.
 //
-//	NOTE: this abstraction is not completely implemented.
+//	Sleeping threads are kept on a list sorted by wake-up time.
+//	Besides checking that list on every timer interrupt, the alarm
+//	schedules a one-shot interrupt for the earliest wake-up, so a
+//	sleeper is woken on time even if the timer is suspended, and an
+//	idle machine skips straight to it.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -19,21 +23,54 @@
 
 #include "callback.h"
 #include "copyright.h"
+#include "interrupt.h"
+#include "list.h"
 #include "timer.h"
 #include "utility.h"
 
+class Thread;
+
+// A thread waiting in Alarm::WaitUntil
+class Sleeper {
+   public:
+    Sleeper(Thread *t, int time) : thread(t), when(time) {}
+    Thread *thread;  // the sleeping thread
+    int when;        // when it is to be woken up
+};
+
+// One-shot interrupt handler for the earliest sleeper's wake-up
+class WakeUpCall : public CallBackObj {
+   public:
+    void CallBack();
+};
+
 // The following class defines a software alarm clock.
 class Alarm : public CallBackObj {
    public:
-    Alarm(bool doRandomYield);  // Initialize the timer, and callback
-                                // to "toCall" every time slice.
-    ~Alarm() { delete timer; }
+    Alarm(bool doRandomYield, bool doTickless);  // Initialize the timer, and
+                                                 // callback to "toCall" every
+                                                 // time slice.
+    ~Alarm();
+
+    void Resume();  // a thread became ready; restart time slicing
+                    // if it had been suspended
 
-    void WaitUntil(int x);  // suspend execution until time > now + x
-                            // this method is not yet implemented
+    void WaitUntil(int x);  // suspend execution until time >= now + x
+    void WakeUp();          // wake up the sleepers that are due
 
    private:
-    Timer *timer;  // the hardware timer device
+    friend class WakeUpCall;
+
+    Timer *timer;   // the hardware timer device
+    bool tickless;  // stop the timer while no thread could be
+                    // preempted by a time slice
+    SortedList<Sleeper *> *sleepers;  // sorted by wake-up time
+    WakeUpCall wakeUpCall;            // handler for "wakeUp"
+    PendingInterrupt *wakeUp;         // interrupt for the earliest
+                                      // sleeper, if scheduled
+    int wakeUpTime;                   // when "wakeUp" occurs
+
+    void ScheduleWakeUp();  // (re)arm "wakeUp" for the first sleeper
 
     void CallBack();  // called when the hardware
                       // timer generates an interrupt
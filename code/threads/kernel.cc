@@ -9,14 +9,19 @@
 
 #include "copyright.h"
 #include "debug.h"
+#include "fdtable.h"
+#include "imagecache.h"
+#include "ioring.h"
 #include "libtest.h"
 #include "main.h"
 #include "post.h"
+#include "shm.h"
 #include "string.h"
 #include "synch.h"
 #include "synchconsole.h"
 #include "synchdisk.h"
 #include "synchlist.h"
+#include "syscall.h"
 #include "sysdep.h"
 
 //----------------------------------------------------------------------
@@ -27,15 +32,25 @@
 
 Kernel::Kernel(int argc, char **argv) {
     randomSlice = FALSE;
+    tickless = TRUE;
+    for (int i = 0; i < 3; i++)
+        quantum[i] = 0;
+    adaptiveQuantum = FALSE;
+    syscallReport = FALSE;
+    syscallTrace = FALSE;
     debugUserProg = FALSE;
     execExit = FALSE;
+    execRunningNum = 0;
+    execfileNum = 0;
+    execfile = new char *[argc];  // more than enough for all -e flags
+    execfilePriority = new int[argc];
     consoleIn = NULL;   // default is stdin
     consoleOut = NULL;  // default is stdout
 #ifndef FILESYS_STUB
     formatFlag = FALSE;
 #endif
     for (int i = 0; i < NumPhysPages; i++)
-        usedPhysPages[i] = false;
+        physPageRefs[i] = 0;
     usedPhysPageSize = 0;
 
     reliability = 1;  // network reliability, default is 1.0
@@ -48,6 +63,19 @@ Kernel::Kernel(int argc, char **argv) {
                                             // number generator
             randomSlice = TRUE;
             i++;
+        } else if (strcmp(argv[i], "-pt") == 0) {
+            tickless = FALSE;  // keep the timer ticking even when idle
+        } else if (strcmp(argv[i], "-tq") == 0) {
+            ASSERT(i + 3 < argc);  // quanta of L1, L2, L3 in ticks
+            quantum[Scheduler::READYL1_LEVEL] = atoi(argv[++i]);
+            quantum[Scheduler::READYL2_LEVEL] = atoi(argv[++i]);
+            quantum[Scheduler::READYL3_LEVEL] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-aq") == 0) {
+            adaptiveQuantum = TRUE;
+        } else if (strcmp(argv[i], "-ss") == 0) {
+            syscallReport = TRUE;
+        } else if (strcmp(argv[i], "-st") == 0) {
+            syscallTrace = TRUE;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
         } else if (strcmp(argv[i], "-e") == 0) {
@@ -84,7 +112,10 @@ Kernel::Kernel(int argc, char **argv) {
             i++;
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
+            cout << "Partial usage: nachos [-pt]\n";
+            cout << "Partial usage: nachos [-tq L1 L2 L3] [-aq]\n";
             cout << "Partial usage: nachos [-s]\n";
+            cout << "Partial usage: nachos [-ss] [-st]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-nf]\n";
@@ -106,13 +137,24 @@ void Kernel::Initialize() {
     // But if it ever tries to give up the CPU, we better have a Thread
     // object to save its state.
 
-    currentThread = new Thread("main", threadNum++);
+    currentThread = new Thread("main", 0);
 
     stats = new Statistics();        // collect statistics
     currentThread->setStatus(RUNNING);
     interrupt = new Interrupt;       // start up interrupt handling
+    syscallStats = new SyscallStats(syscallReport, syscallTrace);
+    processTable = new ProcessTable();  // no user processes yet
+    futexTable = new FutexTable();
+    ioService = new IoService();
+    shmTable = new ShmTable();
+    imageCache = new ImageCache();
     scheduler = new Scheduler();     // initialize the ready queue
-    alarm = new Alarm(randomSlice);  // start up time slicing
+    for (int i = 0; i < 3; i++) {
+        if (quantum[i] > 0)
+            scheduler->SetQuantum(i, quantum[i]);
+    }
+    scheduler->SetAdaptiveQuantum(adaptiveQuantum);
+    alarm = new Alarm(randomSlice, tickless);  // start up time slicing
     machine = new Machine(debugUserProg);
     synchConsoleIn = new SynchConsoleInput(consoleIn);     // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut);  // output to stdout
@@ -134,6 +176,12 @@ void Kernel::Initialize() {
 //----------------------------------------------------------------------
 
 Kernel::~Kernel() {
+    delete processTable;
+    delete futexTable;
+    delete ioService;
+    delete shmTable;  // after the address spaces attached to it
+    delete imageCache;  // ... and the ones sharing its pages
+    delete syscallStats;
     delete stats;
     delete interrupt;
     delete scheduler;
@@ -143,6 +191,8 @@ Kernel::~Kernel() {
     delete synchConsoleOut;
     delete synchDisk;
     delete fileSystem;
+    delete[] execfile;
+    delete[] execfilePriority;
     // delete postOfficeIn;
     // delete postOfficeOut;
 
@@ -167,11 +217,27 @@ void Kernel::ThreadSelfTest() {
     semaphore->SelfTest();
     delete semaphore;
 
+    // test reader-writer locks, barriers and latches
+    for (int policy = WriterPreferred; policy <= FairRW; policy++) {
+        RWLock *rwLock = new RWLock("test", (RWPolicy)policy);
+        rwLock->SelfTest();
+        delete rwLock;
+    }
+    Barrier *barrier = new Barrier("test", 4);
+    barrier->SelfTest();
+    delete barrier;
+    Latch *latch = new Latch("test", 3);
+    latch->SelfTest();
+    delete latch;
+
     // test locks, condition variables
     // using synchronized lists
     synchList = new SynchList<int>;
     synchList->SelfTest(9);
     delete synchList;
+    synchList = new SynchList<int>(4);  // bounded, with back-pressure
+    synchList->SelfTest(9);
+    delete synchList;
 }
 
 //----------------------------------------------------------------------
@@ -180,7 +246,7 @@ void Kernel::ThreadSelfTest() {
 //----------------------------------------------------------------------
 
 void Kernel::ConsoleTest() {
-    char ch;
+    int ch;
 
     cout << "Testing the console device.\n"
          << "Typed characters will be echoed, until ^D is typed.\n"
@@ -254,16 +320,20 @@ void Kernel::NetworkTest() {
 }
 
 void ForkExecute(Thread *t) {
-    if (!t->space->Load(t->getName())) {
-        return;  // executable not found
-    }
-
-    t->space->Execute(t->getName());
+    t->space->Execute(t->getName());  // loaded by Kernel::Exec
 }
 
+//----------------------------------------------------------------------
+// Kernel::IsPhysPageValid, Kernel::CanAllocatePages,
+// Kernel::AllocatePage, Kernel::ReleasePage
+//	The frame allocator.  Frames are reference counted, so that a
+//	frame mapped by several address spaces (shared memory) is only
+//	freed once the last of them lets go of it.
+//----------------------------------------------------------------------
+
 bool Kernel::IsPhysPageValid(int physPageID) {
     if (physPageID < 0 || physPageID >= NumPhysPages) return FALSE;
-    return !usedPhysPages[physPageID];
+    return physPageRefs[physPageID] == 0;
 }
 
 bool Kernel::CanAllocatePages(int allocatedPageSize) {
@@ -272,37 +342,104 @@ bool Kernel::CanAllocatePages(int allocatedPageSize) {
 
 bool Kernel::AllocatePage(int physPageID) {
     if (physPageID < 0 || physPageID >= NumPhysPages) return FALSE; // Check if page ID is legal
-    if (usedPhysPages[physPageID]) return FALSE; // Check if certain page is being used
+    if (physPageRefs[physPageID] > 0) return FALSE; // Check if certain page is being used
 
     usedPhysPageSize++;
-    usedPhysPages[physPageID] = TRUE;
+    physPageRefs[physPageID] = 1;
     return TRUE;
 }
 
 void Kernel::ReleasePage(int physPageID) {
     if (physPageID < 0 || physPageID >= NumPhysPages) return;
-    if (!usedPhysPages[physPageID]) return;
-    usedPhysPages[physPageID] = FALSE;
-    usedPhysPageSize--;
+    if (physPageRefs[physPageID] == 0) return;
+    if (--physPageRefs[physPageID] == 0) {
+        usedPhysPageSize--;
+    }
+}
+
+//----------------------------------------------------------------------
+// Kernel::SharePage, Kernel::IsPageShared
+//	Add a reference to a frame in use, for another mapping of it;
+//	and tell whether a frame has more than one reference.
+//----------------------------------------------------------------------
+
+void Kernel::SharePage(int physPageID) {
+    ASSERT(physPageID >= 0 && physPageID < NumPhysPages);
+    ASSERT(physPageRefs[physPageID] > 0);
+    physPageRefs[physPageID]++;
+}
+
+bool Kernel::IsPageShared(int physPageID) {
+    return physPageID >= 0 && physPageID < NumPhysPages &&
+           physPageRefs[physPageID] > 1;
+}
+
+//----------------------------------------------------------------------
+// Kernel::AllocateFreePage
+//	Allocate whichever physical page is free.  Returns its number,
+//	or -1 if memory is full.
+//----------------------------------------------------------------------
+
+int Kernel::AllocateFreePage() {
+    for (int i = 0; i < NumPhysPages; i++) {
+        if (AllocatePage(i)) {
+            return i;
+        }
+    }
+    return -1;
 }
 
 void Kernel::ExecAll() {
     for (int i = 1; i <= execfileNum; i++) {
-        int a = Exec(execfile[i], execfilePriority[i]);
+        int a = Exec(execfile[i], execfilePriority[i], 0, NULL);
     }
     currentThread->Finish();
     // Kernel::Exec();
 }
 
-int Kernel::Exec(char *name, int priority) {
-    t[threadNum] = new Thread(name, threadNum);
-    t[threadNum]->setPriority(priority);
-    t[threadNum]->setIsExec();
-    t[threadNum]->space = new AddrSpace();
-    t[threadNum]->Fork((VoidFunctionPtr)&ForkExecute, (void *)t[threadNum]);
-    threadNum++;
+//----------------------------------------------------------------------
+// Kernel::Exec
+// 	Start running user program "name" in a new process, at the given
+//	priority, with "argc" arguments "argv" (none if argc is 0).  The
+//	process's thread has the PID as its ID.  If a user process is
+//	running, the new process is its child, and starts with the same
+//	files open.  The program is loaded before the process starts, so
+//	that the caller learns whether it could be.
+//
+//	Returns the PID, EAGAIN if the process table is full, or the
+//	error from AddrSpace::Load (ENOENT, ENOEXEC or ENOMEM).
+//----------------------------------------------------------------------
+
+int Kernel::Exec(char *name, int priority, int argc, char **argv) {
+    Process *process = processTable->Create(name);
+    int result;
+
+    if (process == NULL) {
+        return EAGAIN;
+    }
+    process->space = new AddrSpace();
+    result = process->space->Load(name);
+    if (result < 0) {
+        processTable->Destroy(process);  // nothing else refers to it yet
+        return result;
+    }
+
+    Thread *thread = new Thread(process->getName(), process->getID());
+    thread->setPriority(priority);
+    thread->setIsExec();
+    process->thread = thread;
+    process->priority = priority;
+    process->AddThread(thread, 0);
+    if (argc > 0) {
+        process->space->SetArguments(argc, argv);
+    }
+    if (currentThread->process != NULL) {
+        currentThread->process->AddChild(process);
+        process->files->Inherit(currentThread->process->files);
+    }
+    thread->Fork((VoidFunctionPtr)&ForkExecute, (void *)thread);
 
-    return threadNum - 1;
+    return process->getID();
     /*
         cout << "Total threads number is " << execfileNum << endl;
         for (int n=1;n<=execfileNum;n++) {
@@ -12,13 +12,19 @@
 #include "copyright.h"
 #include "debug.h"
 #include "filesys.h"
+#include "futex.h"
 #include "interrupt.h"
 #include "machine.h"
+#include "process.h"
 #include "scheduler.h"
 #include "stats.h"
+#include "syscallstats.h"
 #include "thread.h"
 #include "utility.h"
 
+class ImageCache;
+class IoService;
+class ShmTable;
 class PostOfficeInput;
 class PostOfficeOutput;
 class SynchConsoleInput;
@@ -37,16 +43,22 @@ class Kernel {
                         // from constructor because
                         // refers to "kernel" as a global
     void ExecAll();
-    int Exec(char *name, int priority);
+    int Exec(char *name, int priority, int argc, char **argv);
     void ThreadSelfTest();  // self test of threads and synchronization
 
     void ConsoleTest();  // interactive console self test
     void NetworkTest();  // interactive 2-machine network test
-    Thread *getThread(int threadID) { return t[threadID]; }
+    Thread *getThread(int threadID) {
+        Process *process = processTable->Lookup(threadID);
+        return process == NULL ? NULL : process->thread;
+    }
     bool IsPhysPageValid(int physPageID);
     bool CanAllocatePages(int allocatedPageSize);
     bool AllocatePage(int physPageID);
     void ReleasePage(int physPageID);
+    int AllocateFreePage();  // any free frame; -1 if none
+    void SharePage(int physPageID);     // one more reference to a frame
+    bool IsPageShared(int physPageID);  // more than one reference?
 
     void PrintInt(int number);
     int CreateFile(char *filename);  // fileSystem call
@@ -69,6 +81,12 @@ class Kernel {
     SynchConsoleOutput *synchConsoleOut;
     SynchDisk *synchDisk;
     FileSystem *fileSystem;
+    ProcessTable *processTable;  // all user processes, by PID
+    FutexTable *futexTable;      // user threads waiting on futexes
+    SyscallStats *syscallStats;  // accounting of system calls
+    IoService *ioService;        // workers for asynchronous I/O
+    ShmTable *shmTable;          // shared memory segments
+    ImageCache *imageCache;      // executables already loaded
     PostOfficeInput *postOfficeIn;
     PostOfficeOutput *postOfficeOut;
     bool execExit;       // exit if all threads are finished
@@ -77,14 +95,17 @@ class Kernel {
     int hostName;  // machine identifier
 
    private:
-    Thread *t[10];
-    char *execfile[10];
-    int execfilePriority[10];
-    bool usedPhysPages[NumPhysPages];
+    char **execfile;        // programs given with -e/-ep, from index 1
+    int *execfilePriority;  // and the priority to run each with
+    int physPageRefs[NumPhysPages];  // mappings of each frame; 0 if free
     int usedPhysPageSize;
     int execfileNum;
-    int threadNum;
     bool randomSlice;    // enable pseudo-random time slicing
+    bool tickless;       // suspend the timer when nothing is ready
+    int quantum[3];      // time slice of L3, L2, L1 (0 = default)
+    bool adaptiveQuantum;  // adjust slices to CPU/IO-bound threads
+    bool syscallReport;  // print system call statistics at halt
+    bool syscallTrace;   // log every system call
     bool debugUserProg;  // single step user program
     double reliability;  // likelihood messages are dropped
     char *consoleIn;     // file to read console input from
@@ -36,6 +36,13 @@ Scheduler::Scheduler() : priorityIntervalSize(4) {
     priorityInterval[1] = 50;
     priorityInterval[2] = 100;
     priorityInterval[3] = 150;
+    for (int i = 0; i < 3; i++) {
+        levelQuantum[i] = TimerTicks;  // slice on every timer interrupt
+    }
+    adaptiveQuantum = FALSE;
+    realTimeThreads = new List<Thread *>;
+    throttled = new List<Thread *>;
+    rtUtilization = 0.0;
     toBeDestroyed = NULL;
 }
 
@@ -45,6 +52,8 @@ Scheduler::Scheduler() : priorityIntervalSize(4) {
 //----------------------------------------------------------------------
 
 Scheduler::~Scheduler() {
+    delete realTimeThreads;
+    delete throttled;
 }
 
 //----------------------------------------------------------------------
@@ -61,13 +70,40 @@ void Scheduler::ReadyToRun(Thread *thread) {
     // cout << "Putting thread on ready list: " << thread->getName() << endl ;
     thread->setStatus(READY);
     int lv = ScheduleLevel(thread->getPriority());
-    if (lv == READYL1_LEVEL) {
+    if (thread->IsThrottled()) {
+        Throttle(thread);  // woke up without budget; wait for release
+        return;
+    } else if (thread->IsRealTime()) {
+        readyRT.Push(thread);
+    } else if (lv == READYL1_LEVEL) {
         readyL1.Push(thread);
     } else if (lv == READYL2_LEVEL) {
         readyL2.Push(thread);
     } else if (lv == READYL3_LEVEL) {
         readyL3.Push(thread);
     }
+    kernel->alarm->Resume();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::HasReadyThreads
+// 	Return TRUE if any of the ready queues is non-empty.
+//----------------------------------------------------------------------
+
+bool Scheduler::HasReadyThreads() {
+    return !readyRT.IsEmpty() || !readyL1.IsEmpty() ||
+           !readyL2.IsEmpty() || !readyL3.IsEmpty();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::TimerNeeded
+// 	Return TRUE if a timer interrupt could change anything: some
+//	thread is waiting for the CPU, or a real-time thread exists
+//	(its budget is enforced and its jobs released from the timer).
+//----------------------------------------------------------------------
+
+bool Scheduler::TimerNeeded() {
+    return HasReadyThreads() || !realTimeThreads->IsEmpty();
 }
 
 //----------------------------------------------------------------------
@@ -83,6 +119,15 @@ Scheduler::FindNextToRun() {
     ASSERT(kernel->interrupt->getLevel() == IntOff);
 
     Thread* t;
+    Thread* curr = kernel->currentThread;
+    if ((t = readyRT.RemoveBest()) != NULL) { // EDF jobs preempt every level
+        return t;
+    }
+
+    // a running real-time job is only preempted by an earlier deadline
+    if (curr->IsRealTime() && curr->getStatus() == RUNNING)
+        return NULL;
+
     if ((t = readyL1.RemoveBest()) != NULL) { // L1 Queue CAN preempt
         return t;
     }
@@ -90,8 +135,8 @@ Scheduler::FindNextToRun() {
     // handled cases are:
     //   * running L1 thread is prior to ready L2/L3 thread
     //   * running L2 thread is prior to ready L2/L3 thread
-    if (ScheduleLevel(kernel->currentThread->getPriority()) >= READYL2_LEVEL &&
-        kernel->currentThread->getStatus() == RUNNING)
+    if (ScheduleLevel(curr->getPriority()) >= READYL2_LEVEL &&
+        curr->getStatus() == RUNNING)
         return NULL;
 
     if ((t = readyL2.RemoveBest()) != NULL) {
@@ -123,7 +168,8 @@ void Scheduler::Aging(Thread *thread) {
         thread->setPriorityUptTick(kernel->stats->totalTicks);
 
         int cap = scheduler->priorityInterval[scheduler->priorityIntervalSize - 1] - 1;
-        int prevPriority = thread->getPriority();
+        int prevLevel = scheduler->ScheduleLevel(thread->getPriority());
+        int prevPriority = thread->getBasePriority();
         int priority = min(prevPriority + AGING_FACTOR, cap);
         thread->setPriority(priority);
 
@@ -131,20 +177,48 @@ void Scheduler::Aging(Thread *thread) {
             << "]: Thread [" << thread->getID() << "] changes its priority from ["
             << prevPriority << "] to [" << priority << "]");
 
-        if (scheduler->ScheduleLevel(prevPriority) != scheduler->ScheduleLevel(priority))
+        if (prevLevel != scheduler->ScheduleLevel(thread->getPriority()))
             scheduler->UpgradeThreadLevel(thread);
     }
 }
 
 void Scheduler::UpgradeThreadLevel(Thread* thread) {
-    // FIXME: hard code the queue to remove
+    Requeue(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Requeue
+// 	The effective priority of "thread" has changed (aging, or
+//	priority inheritance).  If it is waiting in one of the three
+//	level queues, move it to the queue of its new level.  Threads
+//	that are running, blocked, or real-time are left alone.
+//----------------------------------------------------------------------
+
+void Scheduler::Requeue(Thread* thread) {
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    JobQueue *from = NULL;
+    if (readyL1.IsInList(thread)) {
+        from = &readyL1;
+    } else if (readyL2.IsInList(thread)) {
+        from = &readyL2;
+    } else if (readyL3.IsInList(thread)) {
+        from = &readyL3;
+    }
+
+    JobQueue *to;
     int lv = ScheduleLevel(thread->getPriority());
     if (lv == READYL1_LEVEL) {
-        readyL2.Remove(thread);
-        readyL1.Push(thread);
+        to = &readyL1;
     } else if (lv == READYL2_LEVEL) {
-        readyL3.Remove(thread);
-        readyL2.Push(thread);
+        to = &readyL2;
+    } else {
+        to = &readyL3;
+    }
+
+    if (from != NULL && from != to) {
+        from->Remove(thread);
+        to->Push(thread);
     }
 }
 
@@ -155,7 +229,9 @@ void Scheduler::ElevateThreads() {
 }
 
 const char *Scheduler::QueueName(JobQueue *q) {
-    if (q == &readyL1) {
+    if (q == &readyRT) {
+        return "RT";
+    } else if (q == &readyL1) {
         return "L[1]";
     } else if (q == &readyL2) {
         return "L[2]";
@@ -201,6 +277,11 @@ void Scheduler::Run(Thread *nextThread, bool finishing) {
     oldThread->CheckOverflow();  // check if the old thread
                                  // had an undetected stack overflow
 
+    if (nextThread->getRemainingQuantum() <= 0 ||
+        nextThread->getQuantumLevel() != ScheduleLevel(nextThread->getPriority())) {
+        RefillQuantum(nextThread);  // slice used up, or level changed
+    }
+
     kernel->currentThread = nextThread;  // switch to the next thread
     nextThread->setStatus(RUNNING);      // nextThread is now running
 
@@ -216,6 +297,14 @@ void Scheduler::Run(Thread *nextThread, bool finishing) {
           nextThread->getID() << "] is now selected for execution, thread [" <<
           oldThread->getID() << "] is replaced, and it has executed [" <<
           tick << "] ticks");
+    kernel->stats->numContextSwitches++;
+    if (oldThread->process != NULL) {  // charge what it used
+        oldThread->process->usage.Stop();
+        oldThread->process->usage.contextSwitches++;
+    }
+    if (nextThread->process != NULL) {
+        nextThread->process->usage.Start();
+    }
     SWITCH(oldThread, nextThread);
 
     // we're back, running oldThread
@@ -235,6 +324,248 @@ void Scheduler::Run(Thread *nextThread, bool finishing) {
     }
 }
 
+//----------------------------------------------------------------------
+// Scheduler::RefillQuantum
+// 	Give "thread" a full time slice.  A thread that changed level
+//	(or was never scheduled) starts over from its level's base
+//	quantum; otherwise the adaptive quantum is kept.
+//----------------------------------------------------------------------
+
+void Scheduler::RefillQuantum(Thread *thread) {
+    int lv = ScheduleLevel(thread->getPriority());
+
+    if (thread->getQuantumLevel() != lv) {
+        thread->setQuantumLevel(lv);
+        thread->setQuantum(levelQuantum[lv]);
+    }
+    thread->setRemainingQuantum(thread->getQuantum());
+}
+
+//----------------------------------------------------------------------
+// Scheduler::QuantumExpired
+// 	Called on every timer interrupt for the running thread.  Return
+//	TRUE if its time slice is over, in which case a fresh slice is
+//	started right away (it is carried into the ready queue if the
+//	thread is switched out, or used directly if nobody else is
+//	ready).  In adaptive mode a thread that uses its whole slice is
+//	CPU-bound, so its quantum doubles, up to MAX_QUANTUM_SCALE
+//	times its level's quantum.
+//----------------------------------------------------------------------
+
+bool Scheduler::QuantumExpired(Thread *thread) {
+    if (thread->getQuantumLevel() != ScheduleLevel(thread->getPriority())) {
+        RefillQuantum(thread);
+    }
+
+    int left = thread->getRemainingQuantum() - thread->getRunningTick();
+    if (left > 0 && thread->getQuantum() > TimerTicks) {
+        return FALSE;
+    }
+
+    if (adaptiveQuantum) {
+        int cap = levelQuantum[thread->getQuantumLevel()] * MAX_QUANTUM_SCALE;
+        thread->setQuantum(min(thread->getQuantum() * 2, cap));
+    }
+    thread->setRemainingQuantum(thread->getRunningTick() + thread->getQuantum());
+    DEBUG(dbgScheduler, "Tick [" << kernel->stats->totalTicks << "]: Thread ["
+          << thread->getID() << "] quantum expired, next slice ["
+          << thread->getQuantum() << "] ticks");
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::QuantumYielded
+// 	Called when the running thread blocks.  It gets a full slice
+//	when it wakes up; in adaptive mode, blocking before the slice
+//	ran out marks the thread as I/O-bound and halves its quantum
+//	(never below one timer interval).
+//----------------------------------------------------------------------
+
+void Scheduler::QuantumYielded(Thread *thread) {
+    int left = thread->getRemainingQuantum() - thread->getRunningTick();
+
+    if (adaptiveQuantum && left > 0) {
+        thread->setQuantum(max(thread->getQuantum() / 2, TimerTicks));
+    }
+    thread->setRemainingQuantum(0);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::PreemptionPending
+// 	Return TRUE if a thread waiting in a higher queue would take the
+//	CPU from "thread" at the next yield no matter how much of its
+//	slice is left: L1 preempts L2 and L3, and L2 preempts L3.
+//----------------------------------------------------------------------
+
+bool Scheduler::PreemptionPending(Thread *thread) {
+    int lv = ScheduleLevel(thread->getPriority());
+
+    if (lv < READYL1_LEVEL && !readyL1.IsEmpty()) {
+        return TRUE;
+    }
+    return lv == READYL3_LEVEL && !readyL2.IsEmpty();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetRealTime
+// 	Move "thread" into the real-time class: every "period" ticks a
+//	job is released that may run for "budget" ticks and should be
+//	done "deadline" ticks after its release.  Real-time threads are
+//	scheduled earliest deadline first, ahead of all three levels.
+//
+//	Admission control: EDF meets every deadline as long as the
+//	total utilization (sum of budget/period) is at most 1, so a
+//	request that would exceed that, or has inconsistent parameters,
+//	is refused.  Returns TRUE if the thread was admitted.
+//
+//	The first job is released immediately.
+//----------------------------------------------------------------------
+
+bool Scheduler::SetRealTime(Thread *thread, int period, int budget, int deadline) {
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    if (period <= 0 || budget <= 0 || deadline < budget || deadline > period) {
+        return FALSE;
+    }
+    if (thread->IsRealTime()) {  // re-declaring: replace the old share
+        LeaveRealTime(thread);
+    }
+    double utilization = (double)budget / period;
+    if (rtUtilization + utilization > 1.0) {
+        DEBUG(dbgScheduler, "Tick [" << kernel->stats->totalTicks << "]: Thread ["
+              << thread->getID() << "] refused real-time admission");
+        return FALSE;
+    }
+    rtUtilization += utilization;
+
+    RealTimeParams *rt = new RealTimeParams;
+    int now = kernel->stats->totalTicks;
+    rt->period = period;
+    rt->budget = budget;
+    rt->deadline = deadline;
+    rt->budgetLeft = budget;
+    rt->absDeadline = now + deadline;
+    rt->nextRelease = now + period;
+    rt->chargeTick = now;
+    rt->missed = FALSE;
+    thread->setRealTime(rt);
+    realTimeThreads->Append(thread);
+    kernel->alarm->Resume();  // budgets are enforced by the timer
+
+    DEBUG(dbgScheduler, "Tick [" << now << "]: Thread [" << thread->getID()
+          << "] admitted as real-time, period [" << period << "], budget ["
+          << budget << "], deadline [" << deadline << "]");
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::LeaveRealTime
+// 	Take "thread" out of the real-time class (it is finishing, or
+//	re-declaring its parameters) and release its utilization.
+//----------------------------------------------------------------------
+
+void Scheduler::LeaveRealTime(Thread *thread) {
+    RealTimeParams *rt = thread->getRealTime();
+
+    rtUtilization -= (double)rt->budget / rt->period;
+    realTimeThreads->Remove(thread);
+    if (throttled->IsInList(thread)) {
+        throttled->Remove(thread);
+    }
+    if (readyRT.IsInList(thread)) {
+        readyRT.Remove(thread);
+    }
+    thread->setRealTime(NULL);
+    delete rt;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ChargeRealTime
+// 	Charge the CPU time a running real-time thread used since the
+//	last charge against the budget of its current job.
+//----------------------------------------------------------------------
+
+void Scheduler::ChargeRealTime(Thread *thread) {
+    RealTimeParams *rt = thread->getRealTime();
+
+    if (rt != NULL) {
+        int now = kernel->stats->totalTicks;
+        bool hadBudget = rt->budgetLeft > 0;
+        rt->budgetLeft -= now - rt->chargeTick;
+        rt->chargeTick = now;
+        if (hadBudget && rt->budgetLeft <= 0) {
+            kernel->stats->numBudgetOverruns++;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Throttle
+// 	"thread" has used up its budget; keep it off the ready queues
+//	until RealTimeTick releases its next job.
+//----------------------------------------------------------------------
+
+void Scheduler::Throttle(Thread *thread) {
+    DEBUG(dbgScheduler, "Tick [" << kernel->stats->totalTicks << "]: Thread ["
+          << thread->getID() << "] is throttled until tick ["
+          << thread->getRealTime()->nextRelease << "]");
+    throttled->Append(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::RealTimeTick
+// 	Called on every timer interrupt, idle or not.  Charge the running
+//	real-time thread, count jobs that reached their deadline while
+//	still wanting the CPU, and release new jobs (putting throttled
+//	threads back on the ready queue).
+//
+//	Returns TRUE if the running thread should yield: it is out of
+//	budget, or a real-time job is ready and may have an earlier
+//	deadline (FindNextToRun makes the final decision).
+//----------------------------------------------------------------------
+
+bool Scheduler::RealTimeTick() {
+    Thread *curr = kernel->currentThread;
+    int now = kernel->stats->totalTicks;
+
+    if (realTimeThreads->IsEmpty()) {
+        return FALSE;
+    }
+    if (curr->IsRealTime() && curr->getStatus() == RUNNING) {
+        ChargeRealTime(curr);
+    }
+
+    ListIterator<Thread *> iter(realTimeThreads);
+    for (; !iter.IsDone(); iter.Next()) {
+        Thread *thread = iter.Item();
+        RealTimeParams *rt = thread->getRealTime();
+        ThreadStatus status = thread->getStatus();
+
+        if (!rt->missed && now >= rt->absDeadline && rt->budgetLeft > 0 &&
+            (status == READY || status == RUNNING)) {
+            rt->missed = TRUE;  // still runnable, job unfinished
+            kernel->stats->numDeadlineMisses++;
+            DEBUG(dbgScheduler, "Tick [" << now << "]: Thread [" << thread->getID()
+                  << "] missed its deadline [" << rt->absDeadline << "]");
+        }
+        if (now >= rt->nextRelease) {
+            // skip whole periods we slept through
+            int release = rt->nextRelease +
+                          (now - rt->nextRelease) / rt->period * rt->period;
+            rt->absDeadline = release + rt->deadline;
+            rt->nextRelease = release + rt->period;
+            rt->budgetLeft = rt->budget;
+            rt->missed = FALSE;
+            if (throttled->IsInList(thread)) {
+                throttled->Remove(thread);
+                ReadyToRun(thread);
+            }
+        }
+    }
+
+    return curr->IsThrottled() || !readyRT.IsEmpty();
+}
+
 //----------------------------------------------------------------------
 // Scheduler::CheckToBeDestroyed
 // 	If the old thread gave up the processor because it was finishing,
@@ -292,7 +623,7 @@ Thread* SJFQueue::RemoveBest() {
 
     Thread *curr = kernel->currentThread;
     int lv = kernel->scheduler->ScheduleLevel(curr->getPriority());
-    if (lv == Scheduler::READYL1_LEVEL && curr->getStatus() == RUNNING) {
+    if (lv == Scheduler::READYL1_LEVEL && !curr->IsRealTime() && curr->getStatus() == RUNNING) {
         double curr_tick = curr->getApproRemainingTick();
         double best_tick = best->getApproBurstTick();
         if (curr_tick < best_tick ||
@@ -318,6 +649,26 @@ Thread* PriorityQueue::RemoveBest() {
     return best;
 }
 
+Thread* EDFQueue::RemoveBest() {
+    if (list->IsEmpty()) return NULL;
+    ListIterator<Thread*> iter(list);
+    Thread *best = NULL;
+    while (!iter.IsDone()) {
+        if (best == NULL || iter.Item()->getRealTime()->absDeadline < best->getRealTime()->absDeadline || iter.Item()->getRealTime()->absDeadline == best->getRealTime()->absDeadline && iter.Item()->getID() < best->getID()) {
+            best = iter.Item();
+        }
+        iter.Next();
+    }
+
+    Thread *curr = kernel->currentThread;
+    if (curr->IsRealTime() && !curr->IsThrottled() && curr->getStatus() == RUNNING &&
+        curr->getRealTime()->absDeadline <= best->getRealTime()->absDeadline)
+        return NULL;
+
+    Remove(best);
+    return best;
+}
+
 Thread* RRQueue::RemoveBest() {
     if (list->IsEmpty()) return NULL;
     Thread *t = list->Front();
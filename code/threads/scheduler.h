@@ -47,6 +47,11 @@ class RRQueue: public JobQueue {
    Thread* RemoveBest();
 };
 
+class EDFQueue: public JobQueue {
+   public:
+   Thread* RemoveBest();
+};
+
 class Scheduler {
    public:
     static const int READYL1_LEVEL = 2;
@@ -61,25 +66,54 @@ class Scheduler {
     Thread* FindNextToRun();  // Dequeue first thread on the ready
                               // list, if any, and return thread.
     void UpgradeThreadLevel(Thread* thread);
+    void Requeue(Thread* thread);  // priority changed; move a ready
+                                   // thread to the matching queue
     void ElevateThreads();
     void Run(Thread* nextThread, bool finishing);
     // Cause nextThread to start running
     void CheckToBeDestroyed();  // Check if thread that had been
                                 // running needs to be deleted
     void Print();               // Print contents of ready list
+    bool HasReadyThreads();     // Is any thread waiting for the CPU?
     const char *QueueName(JobQueue *q);
     int ScheduleLevel(int priority);
 
     static void Aging(Thread *thread);
 
+    // Time slice management; quanta are in ticks and can be no finer
+    // than the timer, so anything up to TimerTicks means "one tick".
+    void SetQuantum(int level, int ticks) { levelQuantum[level] = ticks; }
+    void SetAdaptiveQuantum(bool adaptive) { adaptiveQuantum = adaptive; }
+    bool QuantumExpired(Thread *thread);   // charge a timer tick
+    void QuantumYielded(Thread *thread);   // thread blocks mid-slice
+    bool PreemptionPending(Thread *thread);  // higher level is ready
+
+    // Real-time (EDF) class, scheduled ahead of L1
+    bool SetRealTime(Thread *thread, int period, int budget, int deadline);
+    void LeaveRealTime(Thread *thread);
+    void ChargeRealTime(Thread *thread);  // charge CPU time to the budget
+    void Throttle(Thread *thread);        // park until the next release
+    bool RealTimeTick();  // timer work; TRUE if current should yield
+    bool TimerNeeded();   // does any thread depend on timer interrupts?
+
     // SelfTest for scheduler is implemented in class Thread
 
    private:
     static const int AGING_PERIOD = 1500;
     static const int AGING_FACTOR = 10;
+    static const int MAX_QUANTUM_SCALE = 8;  // adaptive quantum limit,
+                                             // relative to the level's
+
+    int levelQuantum[3];   // base time slice of each queue level
+    bool adaptiveQuantum;  // stretch/shrink slices by thread behaviour
+    void RefillQuantum(Thread *thread);
 
     int priorityInterval[4];
     int priorityIntervalSize;
+    EDFQueue readyRT;
+    List<Thread *> *realTimeThreads;  // all threads in the EDF class
+    List<Thread *> *throttled;        // out of budget until next release
+    double rtUtilization;             // sum of budget/period admitted
     SJFQueue readyL1;
     PriorityQueue readyL2;
     RRQueue readyL3;
@@ -21,12 +21,12 @@
 // this by implementing locks and condition variables on top of
 // semaphores, instead of directly enabling and disabling interrupts.
 //
-// Locks are implemented using a semaphore to keep track of
-// whether the lock is held or not -- a semaphore value of 0 means
-// the lock is busy; a semaphore value of 1 means the lock is free.
+// Here, though, locks keep their own queue of waiting threads (rather
+// than using a semaphore), because priority inheritance needs to know
+// who is waiting for which lock.
 //
-// The implementation of condition variables using semaphores is
-// a bit trickier, as explained below under Condition::Wait.
+// Condition variables work directly on thread queues too; waiters
+// are moved from the condition onto the lock when signalled.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -67,6 +67,9 @@ Semaphore::~Semaphore() {
 //	value and decrementing must be done atomically, so we
 //	need to disable interrupts before checking the value.
 //
+//	If we have to wait, V() hands its unit directly to us and
+//	takes us off the queue; nothing else wakes us up.
+//
 //	Note that Thread::Sleep assumes that interrupts are disabled
 //	when it is called.
 //----------------------------------------------------------------------
@@ -79,11 +82,13 @@ void Semaphore::P() {
     // disable interrupts
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-    while (value == 0) {               // semaphore not available
+    if (value > 0) {
+        value--;  // semaphore available, consume its value
+    } else {
         queue->Append(currentThread);  // so go to sleep
         currentThread->Sleep(FALSE);
+        ASSERT(!queue->IsInList(currentThread));  // V() gave us its unit
     }
-    value--;  // semaphore available, consume its value
 
     // re-enable interrupts
     (void)interrupt->SetLevel(oldLevel);
@@ -104,10 +109,11 @@ void Semaphore::V() {
     // disable interrupts
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-    if (!queue->IsEmpty()) {  // make thread ready.
+    if (!queue->IsEmpty()) {  // make thread ready, handing it the unit
         kernel->scheduler->ReadyToRun(queue->RemoveFront());
+    } else {
+        value++;
     }
-    value++;
 
     // re-enable interrupts
     (void)interrupt->SetLevel(oldLevel);
@@ -151,8 +157,13 @@ void Semaphore::SelfTest() {
 
 Lock::Lock(char *debugName) {
     name = debugName;
-    semaphore = new Semaphore("lock", 1);  // initially, unlocked
-    lockHolder = NULL;
+    waiters = new List<Thread *>;
+    lockHolder = NULL;  // initially, unlocked
+#ifdef LOCK_STATS
+    stats = FindStats(debugName);
+    stats->numLocks++;
+    acquiredTick = 0;
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -160,36 +171,260 @@ Lock::Lock(char *debugName) {
 // 	Deallocate a lock
 //----------------------------------------------------------------------
 Lock::~Lock() {
-    delete semaphore;
+    ASSERT(waiters->IsEmpty());
+    delete waiters;
 }
 
 //----------------------------------------------------------------------
 // Lock::Acquire
 //	Atomically wait until the lock is free, then set it to busy.
-//	Equivalent to Semaphore::P(), with the semaphore value of 0
-//	equal to busy, and semaphore value of 1 equal to free.
+//
+//	While we wait, our priority is donated to the holder (and along
+//	the chain of locks it is waiting for).  A lower-priority holder
+//	means a priority inversion, which is counted in the statistics.
+//	When Release() wakes us up, it has already made us the holder.
 //----------------------------------------------------------------------
 
 void Lock::Acquire() {
-    semaphore->P();
-    lockHolder = kernel->currentThread;
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Thread *currentThread = kernel->currentThread;
+
+    ASSERT(!IsHeldByCurrentThread());
+    if (lockHolder == NULL) {
+        lockHolder = currentThread;
+        currentThread->getHeldLocks()->Append(this);
+#ifdef LOCK_STATS
+        stats->acquisitions++;
+        Acquired();
+#endif
+    } else {
+#ifdef LOCK_STATS
+        Contended(currentThread);
+#endif
+        if (lockHolder->getPriority() < currentThread->getPriority()) {
+            kernel->stats->numPriorityInversions++;
+            DEBUG(dbgThread, "Priority inversion on " << name << ": thread "
+                  << currentThread->getID() << " waits for thread " << lockHolder->getID());
+        }
+        waiters->Append(currentThread);
+        currentThread->setWaitingOn(this);
+        UpdateInheritance(lockHolder);
+        currentThread->Sleep(FALSE);
+        ASSERT(lockHolder == currentThread);  // handed over by Release
+    }
+
+    (void)kernel->interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Lock::Release
 //	Atomically set lock to be free, waking up a thread waiting
-//	for the lock, if any.
-//	Equivalent to Semaphore::V(), with the semaphore value of 0
-//	equal to busy, and semaphore value of 1 equal to free.
+//	for the lock, if any.  The lock goes directly to the waiter
+//	with the highest priority (the earliest one, among equals), so
+//	nobody can barge in before it runs.  Whatever priority we
+//	inherited through this lock is given up.
 //
 //	By convention, only the thread that acquired the lock
 // 	may release it.
 //---------------------------------------------------------------------
 
 void Lock::Release() {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Thread *currentThread = kernel->currentThread;
+
     ASSERT(IsHeldByCurrentThread());
+    currentThread->getHeldLocks()->Remove(this);
     lockHolder = NULL;
-    semaphore->V();
+#ifdef LOCK_STATS
+    int held = kernel->stats->totalTicks - acquiredTick;
+    stats->totalHold += held;
+    stats->maxHold = max(stats->maxHold, held);
+#endif
+
+    if (!waiters->IsEmpty()) {
+        Thread *next = NULL;
+        ListIterator<Thread *> iter(waiters);
+        for (; !iter.IsDone(); iter.Next()) {
+            if (next == NULL || iter.Item()->getPriority() > next->getPriority()) {
+                next = iter.Item();
+            }
+        }
+        waiters->Remove(next);
+        next->setWaitingOn(NULL);
+        lockHolder = next;
+        next->getHeldLocks()->Append(this);
+#ifdef LOCK_STATS
+        Acquired();
+        int waited = kernel->stats->totalTicks - next->getWaitStart();
+        stats->totalWait += waited;
+        stats->maxWait = max(stats->maxWait, waited);
+#endif
+        UpdateInheritance(next);  // it inherits from the other waiters
+        kernel->scheduler->ReadyToRun(next);
+    }
+    UpdateInheritance(currentThread);  // drop what this lock gave us
+
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::AddWaiter
+//	Put "thread", which is blocked, on the queue of waiters as if it
+//	had called Acquire(); Release() will hand it the lock and wake it
+//	up.  The lock must be held.
+//----------------------------------------------------------------------
+
+void Lock::AddWaiter(Thread *thread) {
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    ASSERT(lockHolder != NULL && lockHolder != thread);
+
+#ifdef LOCK_STATS
+    Contended(thread);
+#endif
+    waiters->Append(thread);
+    thread->setWaitingOn(this);
+    UpdateInheritance(lockHolder);
+}
+
+#ifdef LOCK_STATS
+//----------------------------------------------------------------------
+// LockStats::LockStats
+//	Initialize the statistics of the locks named "lockName".
+//----------------------------------------------------------------------
+
+LockStats::LockStats(char *lockName) {
+    name = lockName;
+    numLocks = acquisitions = contended = 0;
+    totalWait = maxWait = totalHold = maxHold = maxWaiters = 0;
+}
+
+List<LockStats *> *Lock::allStats = NULL;
+
+//----------------------------------------------------------------------
+// Lock::FindStats
+//	Return the statistics record of the locks named "lockName",
+//	creating it for the first such lock.
+//----------------------------------------------------------------------
+
+LockStats *
+Lock::FindStats(char *lockName) {
+    LockStats *record;
+
+    if (allStats == NULL) {
+        allStats = new List<LockStats *>;
+    }
+    ListIterator<LockStats *> iter(allStats);
+    for (; !iter.IsDone(); iter.Next()) {
+        if (strcmp(iter.Item()->name, lockName) == 0) {
+            return iter.Item();
+        }
+    }
+    record = new LockStats(lockName);
+    allStats->Append(record);
+    return record;
+}
+
+//----------------------------------------------------------------------
+// Lock::Contended, Lock::Acquired
+//	Bookkeeping for "waiter" queueing up for the lock (which it
+//	will get eventually), from Acquire() or requeued from a
+//	Condition, and for the lock getting a new holder.  Called with
+//	interrupts disabled.  The wait is timed from here until
+//	Release() hands the waiter the lock.
+//----------------------------------------------------------------------
+
+void Lock::Contended(Thread *waiter) {
+    waiter->setWaitStart(kernel->stats->totalTicks);
+    stats->acquisitions++;
+    stats->contended++;
+    stats->maxWaiters = max(stats->maxWaiters, (int)waiters->NumInList() + 1);
+}
+
+void Lock::Acquired() {
+    acquiredTick = kernel->stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// Lock::PrintStats
+//	Print the statistics of every kind of lock, the one threads
+//	spent the most time waiting for first.
+//----------------------------------------------------------------------
+
+static int
+CompareTotalWait(LockStats *x, LockStats *y) {
+    return y->totalWait - x->totalWait;  // largest first
+}
+
+void Lock::PrintStats() {
+    if (allStats == NULL) {
+        return;
+    }
+    SortedList<LockStats *> sorted(CompareTotalWait);
+    ListIterator<LockStats *> iter(allStats);
+    for (; !iter.IsDone(); iter.Next()) {
+        sorted.Insert(iter.Item());
+    }
+
+    cout << "Lock contention (by total wait):\n";
+    ListIterator<LockStats *> sortedIter(&sorted);
+    for (; !sortedIter.IsDone(); sortedIter.Next()) {
+        LockStats *s = sortedIter.Item();
+        cout << "  " << s->name << " (" << s->numLocks << " locks): "
+             << s->acquisitions << " acquisitions, " << s->contended
+             << " contended, wait " << s->totalWait << " (max " << s->maxWait
+             << "), hold " << s->totalHold << " (max " << s->maxHold
+             << "), max waiters " << s->maxWaiters << "\n";
+    }
+}
+#endif  // LOCK_STATS
+
+//----------------------------------------------------------------------
+// Lock::MaxWaiterPriority
+//	Return the highest effective priority of the threads waiting
+//	for this lock, or -1 if there are none.
+//----------------------------------------------------------------------
+
+int Lock::MaxWaiterPriority() {
+    int highest = -1;
+    ListIterator<Thread *> iter(waiters);
+
+    for (; !iter.IsDone(); iter.Next()) {
+        highest = max(highest, iter.Item()->getPriority());
+    }
+    return highest;
+}
+
+//----------------------------------------------------------------------
+// Lock::UpdateInheritance
+//	Recompute the priority "thread" inherits from the waiters of
+//	the locks it holds.  If its effective priority changes, move it
+//	to the right ready queue, and pass the change on to the holder
+//	of the lock it is waiting for, if any.  The walk is bounded, in
+//	case a deadlock has made the chain circular.
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void Lock::UpdateInheritance(Thread *thread) {
+    const int maxDepth = 16;
+
+    for (int depth = 0; thread != NULL && depth < maxDepth; depth++) {
+        int oldPriority = thread->getPriority();
+        int inherited = -1;
+        ListIterator<Lock *> iter(thread->getHeldLocks());
+        for (; !iter.IsDone(); iter.Next()) {
+            inherited = max(inherited, iter.Item()->MaxWaiterPriority());
+        }
+        thread->setInheritedPriority(inherited);
+        if (thread->getPriority() == oldPriority) {
+            return;  // nothing changes further up the chain
+        }
+
+        DEBUG(dbgThread, "Thread " << thread->getID() << " priority " << oldPriority
+              << " -> " << thread->getPriority() << " (inherited " << inherited << ")");
+        kernel->scheduler->Requeue(thread);
+        thread = thread->getWaitingOn() == NULL ? NULL : thread->getWaitingOn()->getHolder();
+    }
 }
 
 //----------------------------------------------------------------------
@@ -202,7 +437,7 @@ void Lock::Release() {
 //----------------------------------------------------------------------
 Condition::Condition(char *debugName) {
     name = debugName;
-    waitQueue = new List<Semaphore *>;
+    waitQueue = new List<Thread *>;
 }
 
 //----------------------------------------------------------------------
@@ -216,30 +451,29 @@ Condition::~Condition() {
 
 //----------------------------------------------------------------------
 // Condition::Wait
-// 	Atomically release monitor lock and go to sleep.
-//	Our implementation uses semaphores to implement this, by
-//	allocating a semaphore for each waiting thread.  The signaller
-//	will V() this semaphore, so there is no chance the waiter
-//	will miss the signal, even though the lock is released before
-//	calling P().
+// 	Atomically release monitor lock and go to sleep.  Interrupts
+//	are disabled from queueing ourselves until we are asleep, so
+//	there is no chance of missing a signal.
 //
 //	Note: we assume Mesa-style semantics, which means that the
-//	waiter must re-acquire the monitor lock when waking up.
+//	waiter must re-acquire the monitor lock when waking up.  Here
+//	that is done for us: the signaller moved us onto the lock's
+//	queue, and we only wake up once Release() has handed us the lock.
 //
 //	"conditionLock" -- lock protecting the use of this condition
 //----------------------------------------------------------------------
 
 void Condition::Wait(Lock *conditionLock) {
-    Semaphore *waiter;
+    Thread *currentThread = kernel->currentThread;
 
     ASSERT(conditionLock->IsHeldByCurrentThread());
 
-    waiter = new Semaphore("condition", 0);
-    waitQueue->Append(waiter);
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    waitQueue->Append(currentThread);
     conditionLock->Release();
-    waiter->P();
-    conditionLock->Acquire();
-    delete waiter;
+    currentThread->Sleep(FALSE);
+    ASSERT(conditionLock->IsHeldByCurrentThread());  // from Release()
+    (void)kernel->interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
@@ -251,32 +485,449 @@ void Condition::Wait(Lock *conditionLock) {
 //	being woken up (unlike Hoare-style).
 //
 //	Also note: we assume the caller holds the monitor lock
-//	(unlike what is described in Birrell's paper).  This allows
-//	us to access waitQueue without disabling interrupts.
+//	(unlike what is described in Birrell's paper).  Interrupts are
+//	still disabled, since Lock's queue is also used by Acquire().
+//
+//	The waiter is not made ready; it is moved to the lock's queue,
+//	and runs once it has been handed the lock.
 //
 //	"conditionLock" -- lock protecting the use of this condition
 //----------------------------------------------------------------------
 
 void Condition::Signal(Lock *conditionLock) {
-    Semaphore *waiter;
-
     ASSERT(conditionLock->IsHeldByCurrentThread());
 
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
     if (!waitQueue->IsEmpty()) {
-        waiter = waitQueue->RemoveFront();
-        waiter->V();
+        conditionLock->AddWaiter(waitQueue->RemoveFront());
     }
+    (void)kernel->interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Condition::Broadcast
-// 	Wake up all threads waiting on this condition, if any.
+// 	Wake up all threads waiting on this condition, if any.  They
+//	are all requeued onto the lock, which wakes them one at a time
+//	as it is passed along, instead of all at once.
 //
 //	"conditionLock" -- lock protecting the use of this condition
 //----------------------------------------------------------------------
 
 void Condition::Broadcast(Lock *conditionLock) {
+    ASSERT(conditionLock->IsHeldByCurrentThread());
+
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
     while (!waitQueue->IsEmpty()) {
-        Signal(conditionLock);
+        conditionLock->AddWaiter(waitQueue->RemoveFront());
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a reader-writer lock, initially free.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"rwPolicy" says who goes first when readers and writers wait.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char *debugName, RWPolicy rwPolicy) {
+    name = debugName;
+    policy = rwPolicy;
+    readers = 0;
+    writer = NULL;
+    waitingWriters = 0;
+    waiters = new List<Waiter *>;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+// 	De-allocate a reader-writer lock, when no one is using it.
+//----------------------------------------------------------------------
+
+RWLock::~RWLock() {
+    ASSERT(readers == 0 && writer == NULL && waiters->IsEmpty());
+    delete waiters;
+}
+
+//----------------------------------------------------------------------
+// RWLock::MustWait
+// 	Return TRUE if a thread wanting to read (or write, if "writing")
+//	cannot have the lock right away.  A reader also waits behind
+//	a waiting writer (WriterPreferred) or anyone waiting (FairRW),
+//	so that writers are not starved.
+//----------------------------------------------------------------------
+
+bool RWLock::MustWait(bool writing) {
+    if (writing) {
+        return writer != NULL || readers > 0;
+    }
+    if (writer != NULL) {
+        return TRUE;
+    }
+    if (policy == WriterPreferred) {
+        return waitingWriters > 0;
+    }
+    return !waiters->IsEmpty();
+}
+
+//----------------------------------------------------------------------
+// RWLock::Wait
+// 	Queue the current thread and go to sleep until Grant() hands us
+//	the lock.  Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void RWLock::Wait(bool writing) {
+    Thread *currentThread = kernel->currentThread;
+    Waiter waiter;
+
+    waiter.thread = currentThread;
+    waiter.writing = writing;
+    waiter.granted = FALSE;
+    waiters->Append(&waiter);
+    if (writing) {
+        waitingWriters++;
+    }
+    DEBUG(dbgSynch, "Thread " << currentThread->getName() << " waits to "
+                              << (writing ? "write " : "read ") << name);
+    currentThread->Sleep(FALSE);
+    ASSERT(waiter.granted);  // from Grant()
+}
+
+//----------------------------------------------------------------------
+// RWLock::Grant
+// 	The lock has just become free (or, for readers, still allows
+//	readers): hand it to the next waiter(s) according to the policy,
+//	and wake them up.  Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void RWLock::Grant() {
+    Waiter *next;
+
+    if (writer != NULL || waiters->IsEmpty()) {
+        return;
+    }
+    if (readers == 0) {
+        // a writer can go: the first one in line, if it is at the front
+        // (FairRW) or anywhere in line (WriterPreferred)
+        next = NULL;
+        if (waiters->Front()->writing) {
+            next = waiters->Front();
+        } else if (policy == WriterPreferred && waitingWriters > 0) {
+            ListIterator<Waiter *> iter(waiters);
+            for (; !iter.IsDone(); iter.Next()) {
+                if (iter.Item()->writing) {
+                    next = iter.Item();
+                    break;
+                }
+            }
+        }
+        if (next != NULL) {
+            waiters->Remove(next);
+            waitingWriters--;
+            writer = next->thread;
+            next->granted = TRUE;
+            kernel->scheduler->ReadyToRun(next->thread);
+            return;
+        }
+    }
+    if (policy == WriterPreferred && waitingWriters > 0) {
+        return;  // readers keep waiting behind the writer
+    }
+    // let in the readers at the front of the line
+    while (!waiters->IsEmpty() && !waiters->Front()->writing) {
+        next = waiters->RemoveFront();
+        readers++;
+        next->granted = TRUE;
+        kernel->scheduler->ReadyToRun(next->thread);
+    }
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReadAcquire, RWLock::ReadRelease
+// 	Acquire the lock for reading, and give it back.
+//----------------------------------------------------------------------
+
+void RWLock::ReadAcquire() {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    if (MustWait(FALSE)) {
+        Wait(FALSE);  // Grant() counted us as a reader
+    } else {
+        readers++;
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+void RWLock::ReadRelease() {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(readers > 0);
+    readers--;
+    if (readers == 0) {
+        Grant();
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::WriteAcquire, RWLock::WriteRelease
+// 	Acquire the lock for writing, and give it back.
+//----------------------------------------------------------------------
+
+void RWLock::WriteAcquire() {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(!IsWriteHeldByCurrentThread());
+    if (MustWait(TRUE)) {
+        Wait(TRUE);  // Grant() made us the writer
+    } else {
+        writer = kernel->currentThread;
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+void RWLock::WriteRelease() {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(IsWriteHeldByCurrentThread());
+    writer = NULL;
+    Grant();
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::SelfTest, RWLockReader, RWLockWriter
+// 	Test the reader-writer lock, by having several readers and
+//	writers go through the lock, yielding while they hold it.  A
+//	writer must always be alone; readers may overlap.
+//----------------------------------------------------------------------
+
+static int rwReading, rwWriting, rwMaxReading;
+static Semaphore *rwDone;
+
+static void
+RWLockReader(RWLock *rwLock) {
+    for (int i = 0; i < 3; i++) {
+        rwLock->ReadAcquire();
+        rwReading++;
+        rwMaxReading = max(rwMaxReading, rwReading);
+        kernel->currentThread->Yield();
+        ASSERT(rwWriting == 0);
+        rwReading--;
+        rwLock->ReadRelease();
+        kernel->currentThread->Yield();
+    }
+    rwDone->V();
+}
+
+static void
+RWLockWriter(RWLock *rwLock) {
+    for (int i = 0; i < 3; i++) {
+        rwLock->WriteAcquire();
+        rwWriting++;
+        kernel->currentThread->Yield();
+        ASSERT(rwWriting == 1 && rwReading == 0);
+        rwWriting--;
+        rwLock->WriteRelease();
+        kernel->currentThread->Yield();
+    }
+    rwDone->V();
+}
+
+void RWLock::SelfTest() {
+    const int numReaders = 3, numWriters = 2;
+
+    ASSERT(readers == 0 && writer == NULL);
+    rwReading = rwWriting = rwMaxReading = 0;
+    rwDone = new Semaphore("rw done", 0);
+    for (int i = 0; i < numReaders; i++) {
+        Thread *t = new Thread("rw reader", 1);
+        t->Fork((VoidFunctionPtr)RWLockReader, this);
+    }
+    for (int i = 0; i < numWriters; i++) {
+        Thread *t = new Thread("rw writer", 1);
+        t->Fork((VoidFunctionPtr)RWLockWriter, this);
+    }
+    for (int i = 0; i < numReaders + numWriters; i++) {
+        rwDone->P();
+    }
+    DEBUG(dbgSynch, "RWLock " << name << ": up to " << rwMaxReading
+                              << " readers at once");
+    ASSERT(readers == 0 && writer == NULL && waiters->IsEmpty());
+    delete rwDone;
+}
+
+//----------------------------------------------------------------------
+// Barrier::Barrier
+// 	Initialize a barrier for "count" threads.
+//----------------------------------------------------------------------
+
+Barrier::Barrier(char *debugName, int count) {
+    ASSERT(count > 0);
+    name = debugName;
+    parties = count;
+    arrived = 0;
+    queue = new List<Thread *>;
+}
+
+//----------------------------------------------------------------------
+// Barrier::~Barrier
+// 	De-allocate a barrier, when no one is waiting at it.
+//----------------------------------------------------------------------
+
+Barrier::~Barrier() {
+    ASSERT(queue->IsEmpty());
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Barrier::Wait
+// 	Wait until all "parties" threads have reached the barrier.  The
+//	last one to arrive wakes up the others, starts the next phase,
+//	and gets TRUE back.
+//----------------------------------------------------------------------
+
+bool Barrier::Wait() {
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    bool last = FALSE;
+
+    arrived++;
+    if (arrived == parties) {
+        while (!queue->IsEmpty()) {
+            kernel->scheduler->ReadyToRun(queue->RemoveFront());
+        }
+        arrived = 0;
+        last = TRUE;
+    } else {
+        queue->Append(currentThread);
+        currentThread->Sleep(FALSE);
+        ASSERT(!queue->IsInList(currentThread));  // from the last one
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+    return last;
+}
+
+//----------------------------------------------------------------------
+// Barrier::SelfTest, BarrierHelper
+// 	Test the barrier, by having all threads go through several
+//	phases; nobody may start a phase before everyone has finished
+//	the previous one.
+//----------------------------------------------------------------------
+
+static const int BarrierPhases = 3;
+static int barrierArrived[BarrierPhases];
+static int barrierParties, barrierLast;
+
+static void
+BarrierHelper(Barrier *barrier) {
+    for (int phase = 0; phase < BarrierPhases; phase++) {
+        barrierArrived[phase]++;
+        kernel->currentThread->Yield();
+        if (barrier->Wait()) {
+            barrierLast++;
+        }
+        ASSERT(barrierArrived[phase] == barrierParties);
+    }
+}
+
+void Barrier::SelfTest() {
+    ASSERT(arrived == 0);
+    barrierParties = parties;
+    barrierLast = 0;
+    for (int phase = 0; phase < BarrierPhases; phase++) {
+        barrierArrived[phase] = 0;
+    }
+    for (int i = 1; i < parties; i++) {
+        Thread *t = new Thread("barrier", 1);
+        t->Fork((VoidFunctionPtr)BarrierHelper, this);
+    }
+    BarrierHelper(this);  // the current thread takes part too
+    ASSERT(barrierLast == BarrierPhases);
+}
+
+//----------------------------------------------------------------------
+// Latch::Latch
+// 	Initialize a latch that opens after "count" calls to CountDown().
+//----------------------------------------------------------------------
+
+Latch::Latch(char *debugName, int initialCount) {
+    ASSERT(initialCount >= 0);
+    name = debugName;
+    count = initialCount;
+    queue = new List<Thread *>;
+}
+
+//----------------------------------------------------------------------
+// Latch::~Latch
+// 	De-allocate a latch, when no one is waiting on it.
+//----------------------------------------------------------------------
+
+Latch::~Latch() {
+    ASSERT(queue->IsEmpty());
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Latch::CountDown
+// 	Record one event; the last one wakes up everyone waiting.
+//----------------------------------------------------------------------
+
+void Latch::CountDown() {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(count > 0);
+    count--;
+    if (count == 0) {
+        while (!queue->IsEmpty()) {
+            kernel->scheduler->ReadyToRun(queue->RemoveFront());
+        }
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Latch::Wait
+// 	Wait until the count has reached zero; returns at once if it
+//	already has.
+//----------------------------------------------------------------------
+
+void Latch::Wait() {
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    if (count > 0) {
+        queue->Append(currentThread);
+        currentThread->Sleep(FALSE);
+        ASSERT(count == 0);  // from CountDown()
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Latch::SelfTest, LatchHelper
+// 	Test the latch, by having a thread wait on it while as many
+//	threads as its count count it down.
+//----------------------------------------------------------------------
+
+static int latchCounted;
+
+static void
+LatchHelper(Latch *latch) {
+    latchCounted++;
+    latch->CountDown();
+}
+
+void Latch::SelfTest() {
+    int initialCount = count;
+
+    latchCounted = 0;
+    for (int i = 0; i < initialCount; i++) {
+        Thread *t = new Thread("latch", 1);
+        t->Fork((VoidFunctionPtr)LatchHelper, this);
     }
+    Wait();
+    ASSERT(count == 0 && latchCounted == initialCount);
+    Wait();  // an open latch doesn't block
 }
@@ -7,6 +7,9 @@
 //	interface is given -- they are to be implemented as part of
 //	the first assignment.
 //
+//	Reader-writer locks, barriers and countdown latches are built
+//	the same way, directly on queues of sleeping threads.
+//
 //	Note that all the synchronization objects take a "name" as
 //	part of the initialization.  This is solely for debugging purposes.
 //
@@ -29,6 +32,10 @@
 //
 //	V() -- increment, waking up a thread waiting in P() if necessary
 //
+// When V() wakes up a waiter, it hands the unit directly to that
+// thread instead of incrementing the value, so the waiter cannot lose
+// the race to a thread that calls P() before it gets to run.
+//
 // Note that the interface does *not* allow a thread to read the value of
 // the semaphore directly -- even if you did read the value, the
 // only thing you would know is what the value used to be.  You don't
@@ -54,6 +61,27 @@ class Semaphore {
     // threads waiting in P() for the value to be > 0
 };
 
+#ifdef LOCK_STATS
+// The following class defines the contention statistics of a lock.
+// Locks with the same debug name (say, the lock of every SynchList)
+// share one record, so the report shows which *kind* of lock is hot.
+
+class LockStats {
+   public:
+    LockStats(char *lockName);
+
+    char *name;        // debug name of the locks
+    int numLocks;      // locks created with this name
+    int acquisitions;  // times the lock was taken
+    int contended;     // ... of which had to wait for it
+    int totalWait;     // ticks spent waiting for the lock
+    int maxWait;
+    int totalHold;     // ticks the lock was held
+    int maxHold;
+    int maxWaiters;    // longest queue of waiters seen
+};
+#endif  // LOCK_STATS
+
 // The following class defines a "lock".  A lock can be BUSY or FREE.
 // There are only two operations allowed on a lock:
 //
@@ -65,6 +93,11 @@ class Semaphore {
 // In addition, by convention, only the thread that acquired the lock
 // may release it.  As with semaphores, you can't read the lock value
 // (because the value might change immediately after you read it).
+//
+// Locks implement priority inheritance: while a thread waits for a
+// lock, the holder runs with (at least) the waiter's priority, and so
+// does whoever holds a lock the holder is waiting for, and so on.
+// Release hands the lock directly to the highest-priority waiter.
 
 class Lock {
    public:
@@ -83,10 +116,30 @@ class Lock {
 
     // Note: SelfTest routine provided by SynchList
 
+    Thread *getHolder() { return lockHolder; }
+    int MaxWaiterPriority();  // highest priority among the waiters
+    void AddWaiter(Thread *thread);  // queue "thread" as if it had
+                                     // called Acquire (used by Condition)
+#ifdef LOCK_STATS
+    static void PrintStats();  // report contention, worst first
+#endif
+
    private:
-    char *name;            // debugging assist
-    Thread *lockHolder;    // thread currently holding lock
-    Semaphore *semaphore;  // we use a semaphore to implement lock
+    char *name;              // debugging assist
+    Thread *lockHolder;      // thread currently holding lock
+    List<Thread *> *waiters;  // threads waiting in Acquire()
+#ifdef LOCK_STATS
+    LockStats *stats;   // shared by all locks with our name
+    int acquiredTick;   // when the holder got the lock
+
+    static List<LockStats *> *allStats;  // one record per lock name
+    static LockStats *FindStats(char *lockName);
+    void Contended(Thread *waiter);  // a thread is queued on the lock
+    void Acquired();    // the lock has a new holder
+#endif
+
+    static void UpdateInheritance(Thread *thread);
+    // recompute inherited priorities, from "thread" up the chain
 };
 
 // The following class defines a "condition variable".  A condition
@@ -121,6 +174,12 @@ class Lock {
 // can acquire the lock, and change data structures, before the woken
 // thread gets a chance to run.  The advantage to Mesa-style semantics
 // is that it is a lot easier to implement than Hoare-style.
+//
+// Signal and Broadcast do not make the waiters ready; they move them
+// onto the lock's queue of waiters, since the first thing a woken
+// thread would do is wait for the lock anyway.  The lock is then
+// handed to them one at a time as it is released, rather than all of
+// them waking up only to block on the lock again.
 
 class Condition {
    public:
@@ -140,6 +199,101 @@ class Condition {
 
    private:
     char *name;
-    List<Semaphore *> *waitQueue;  // list of waiting threads
+    List<Thread *> *waitQueue;  // list of waiting threads
+};
+
+// The following class defines a reader-writer lock.  Any number of
+// threads may hold it for reading at the same time, or one thread may
+// hold it for writing.
+//
+// Under the WriterPreferred policy, a waiting writer keeps new readers
+// out, and writers are served before readers when the lock is freed;
+// readers can starve if writers keep arriving.  Under FairRW, waiters
+// are served in arrival order: a writer first in line gets the lock on
+// its own, otherwise all readers up to the next writer get it together.
+//
+// As with semaphores, a releasing thread hands the lock directly to
+// the waiters it wakes up.
+
+enum RWPolicy { WriterPreferred,
+                FairRW };
+
+class RWLock {
+   public:
+    RWLock(char *debugName, RWPolicy rwPolicy = WriterPreferred);
+    ~RWLock();  // deallocate the lock
+    char *getName() { return name; }
+
+    void ReadAcquire();   // these are all *atomic*
+    void ReadRelease();
+    void WriteAcquire();
+    void WriteRelease();
+
+    bool IsWriteHeldByCurrentThread() {
+        return writer == kernel->currentThread;
+    }
+    void SelfTest();  // test routine for reader-writer locks
+
+   private:
+    struct Waiter {
+        Thread *thread;
+        bool writing;  // waiting to write rather than to read
+        bool granted;  // set by the thread handing over the lock
+    };
+
+    char *name;              // for debugging
+    RWPolicy policy;
+    int readers;             // number of threads reading
+    Thread *writer;          // thread writing, or NULL
+    int waitingWriters;      // writers on "waiters"
+    List<Waiter *> *waiters;  // threads waiting, in arrival order
+
+    bool MustWait(bool writing);    // can't have the lock right now?
+    void Wait(bool writing);        // queue up until it is handed to us
+    void Grant();                   // hand the free lock to waiters
+};
+
+// The following class defines a barrier: each of "count" threads
+// calling Wait() blocks until all of them have called it, at which
+// point they all continue.  The barrier then resets itself, so it can
+// be used again for the next phase.  Wait() returns TRUE in exactly one
+// thread per phase (the last to arrive), e.g. to do per-phase cleanup.
+
+class Barrier {
+   public:
+    Barrier(char *debugName, int count);  // "count" threads take part
+    ~Barrier();
+    char *getName() { return name; }
+
+    bool Wait();      // block until everyone arrives
+    void SelfTest();  // test routine for barriers
+
+   private:
+    char *name;
+    int parties;             // number of threads taking part
+    int arrived;             // threads waiting in this phase
+    List<Thread *> *queue;   // those threads
+};
+
+// The following class defines a countdown latch: Wait() blocks until
+// CountDown() has been called "count" times.  Unlike a barrier, the
+// threads counting down do not wait, and once open the latch stays
+// open.
+
+class Latch {
+   public:
+    Latch(char *debugName, int count);
+    ~Latch();
+    char *getName() { return name; }
+
+    void CountDown();  // one event has happened
+    void Wait();       // block until all have happened
+    int getCount() { return count; }
+    void SelfTest();   // test routine for latches
+
+   private:
+    char *name;
+    int count;              // events still to happen
+    List<Thread *> *queue;  // threads waiting for count to reach 0
 };
 #endif  // SYNCH_H
@@ -18,13 +18,26 @@
 //	Allocate and initialize the data structures needed for a
 //	synchronized list, empty to start with.
 //	Elements can now be added to the list.
+//
+//	"maxItems" is the most items the list can hold, or 0 if there
+//	is no limit.
 //----------------------------------------------------------------------
 
 template <class T>
-SynchList<T>::SynchList() {
-    list = new List<T>;
+SynchList<T>::SynchList(int maxItems) {
+    ASSERT(maxItems >= 0);
+    capacity = maxItems;
+    if (capacity > 0) {
+        list = NULL;
+        ring = new T[capacity];
+    } else {
+        list = new List<T>;
+        ring = NULL;
+    }
+    first = numItems = 0;
     lock = new Lock("list lock");
     listEmpty = new Condition("list empty cond");
+    listFull = new Condition("list full cond");
 }
 
 //----------------------------------------------------------------------
@@ -34,15 +47,61 @@ SynchList<T>::SynchList() {
 
 template <class T>
 SynchList<T>::~SynchList() {
+    delete listFull;
     delete listEmpty;
     delete lock;
-    delete list;
+    if (list != NULL) {
+        delete list;
+    }
+    if (ring != NULL) {
+        delete[] ring;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchList<T>::IsEmpty, IsFull, Put, Get
+//	Operations on the storage of the list, whichever it is.  The
+//	caller holds the lock, and checks there is an item (or room).
+//----------------------------------------------------------------------
+
+template <class T>
+bool SynchList<T>::IsEmpty() {
+    return (list != NULL) ? list->IsEmpty() : (numItems == 0);
+}
+
+template <class T>
+bool SynchList<T>::IsFull() {
+    return list == NULL && numItems == capacity;
+}
+
+template <class T>
+void SynchList<T>::Put(T item) {
+    if (list != NULL) {
+        list->Append(item);
+    } else {
+        ring[(first + numItems) % capacity] = item;
+        numItems++;
+    }
+}
+
+template <class T>
+T SynchList<T>::Get() {
+    T item;
+
+    if (list != NULL) {
+        return list->RemoveFront();
+    }
+    item = ring[first];
+    first = (first + 1) % capacity;
+    numItems--;
+    return item;
 }
 
 //----------------------------------------------------------------------
 // SynchList<T>::Append
-//      Append an "item" to the end of the list.  Wake up anyone
-//	waiting for an element to be appended.
+//      Append an "item" to the end of the list, waiting for room if
+//	the list is bounded.  Wake up anyone waiting for an element to
+//	be appended.
 //
 //	"item" is the thing to put on the list.
 //----------------------------------------------------------------------
@@ -50,11 +109,37 @@ SynchList<T>::~SynchList() {
 template <class T>
 void SynchList<T>::Append(T item) {
     lock->Acquire();  // enforce mutual exclusive access to the list
-    list->Append(item);
+    while (IsFull())
+        listFull->Wait(lock);  // wait until there is room
+    Put(item);
     listEmpty->Signal(lock);  // wake up a waiter, if any
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchList<T>::AppendBatch
+//      Append "count" items to the end of the list, in order.  Only if
+//	a bounded list fills up part way do we have to let go of the
+//	lock, until removers make room.
+//
+//	"items" is the array of things to put on the list.
+//----------------------------------------------------------------------
+
+template <class T>
+void SynchList<T>::AppendBatch(T *items, int count) {
+    int done = 0;
+
+    lock->Acquire();
+    while (done < count) {
+        while (IsFull())
+            listFull->Wait(lock);
+        while (done < count && !IsFull())
+            Put(items[done++]);
+        listEmpty->Broadcast(lock);  // there may be several items
+    }
+    lock->Release();
+}
+
 //----------------------------------------------------------------------
 // SynchList<T>::RemoveFront
 //      Remove an "item" from the beginning of the list.  Wait if
@@ -68,13 +153,39 @@ T SynchList<T>::RemoveFront() {
     T item;
 
     lock->Acquire();  // enforce mutual exclusion
-    while (list->IsEmpty())
+    while (IsEmpty())
         listEmpty->Wait(lock);  // wait until list isn't empty
-    item = list->RemoveFront();
+    item = Get();
+    listFull->Signal(lock);  // there's room for one more
     lock->Release();
     return item;
 }
 
+//----------------------------------------------------------------------
+// SynchList<T>::RemoveUpTo
+//      Remove as many items as are there, up to "count", from the
+//	beginning of the list.  Wait if the list is empty.
+//
+//	"items" is where to put them.
+// Returns:
+//	The number of items removed, at least 1.
+//----------------------------------------------------------------------
+
+template <class T>
+int SynchList<T>::RemoveUpTo(T *items, int count) {
+    int done = 0;
+
+    ASSERT(count > 0);
+    lock->Acquire();
+    while (IsEmpty())
+        listEmpty->Wait(lock);
+    while (done < count && !IsEmpty())
+        items[done++] = Get();
+    listFull->Broadcast(lock);
+    lock->Release();
+    return done;
+}
+
 //----------------------------------------------------------------------
 // SynchList<T>::Apply
 //      Apply function to every item on a list.
@@ -85,15 +196,21 @@ T SynchList<T>::RemoveFront() {
 template <class T>
 void SynchList<T>::Apply(void (*func)(T)) {
     lock->Acquire();  // enforce mutual exclusion
-    list->Apply(func);
+    if (list != NULL) {
+        list->Apply(func);
+    } else {
+        for (int i = 0; i < numItems; i++)
+            (*func)(ring[(first + i) % capacity]);
+    }
     lock->Release();
 }
 
 //----------------------------------------------------------------------
-// SynchList<T>::SelfTest, SelfTestHelper
+// SynchList<T>::SelfTest, SelfTestHelper, SelfTestBatchHelper
 //	Test whether the SynchList implementation is working,
 //	by having two threads ping-pong a value between them
-//	using two synchronized lists.
+//	using two synchronized lists, first one item at a time, then
+//	in batches (larger than a bounded list can hold).
 //----------------------------------------------------------------------
 
 template <class T>
@@ -104,16 +221,44 @@ void SynchList<T>::SelfTestHelper(void* data) {
     }
 }
 
+template <class T>
+void SynchList<T>::SelfTestBatchHelper(void* data) {
+    SynchList<T>* _this = (SynchList<T>*)data;
+    T items[SelfTestBatch];
+    int n;
+
+    for (int done = 0; done < 2 * SelfTestBatch; done += n) {
+        n = _this->selfTestPing->RemoveUpTo(items, SelfTestBatch);
+        _this->AppendBatch(items, n);
+    }
+}
+
 template <class T>
 void SynchList<T>::SelfTest(T val) {
     Thread* helper = new Thread("ping", 1);
+    T items[SelfTestBatch];
+    int n;
 
-    ASSERT(list->IsEmpty());
-    selfTestPing = new SynchList<T>;
+    ASSERT(IsEmpty());
+    selfTestPing = new SynchList<T>(capacity);
     helper->Fork(SynchList<T>::SelfTestHelper, this);
     for (int i = 0; i < 10; i++) {
         selfTestPing->Append(val);
         ASSERT(val == this->RemoveFront());
     }
+
+    helper = new Thread("batch ping", 1);
+    helper->Fork(SynchList<T>::SelfTestBatchHelper, this);
+    for (int i = 0; i < SelfTestBatch; i++)
+        items[i] = val;
+    for (int round = 0; round < 2; round++) {
+        selfTestPing->AppendBatch(items, SelfTestBatch);
+        for (int done = 0; done < SelfTestBatch; done += n) {
+            n = RemoveUpTo(items, SelfTestBatch - done);
+            for (int i = 0; i < n; i++)
+                ASSERT(val == items[i]);
+        }
+    }
+    ASSERT(IsEmpty());
     delete selfTestPing;
 }
@@ -19,31 +19,57 @@
 //	1. Threads trying to remove an item from a list will
 //	wait until the list has an element on it.
 //	2. One thread at a time can access list data structures
+//
+// A list may also be bounded: threads trying to append to a full list
+// wait until there is room.  A bounded list keeps its items in a
+// circular buffer, allocated once, instead of in a List.
+//
+// AppendBatch and RemoveUpTo move several items for one acquisition
+// of the lock (more, for a batch larger than a bounded list has room).
 
 template <class T>
 class SynchList {
    public:
-    SynchList();   // initialize a synchronized list
+    SynchList(int maxItems = 0);  // initialize a synchronized list,
+                                  // holding at most maxItems (0 = no limit)
     ~SynchList();  // de-allocate a synchronized list
 
     void Append(T item);  // append item to the end of the list,
                           // and wake up any thread waiting in remove
 
+    void AppendBatch(T *items, int count);  // append "count" items, in order
+
     T RemoveFront();  // remove the first item from the front of
                       // the list, waiting if the list is empty
 
+    int RemoveUpTo(T *items, int count);  // remove at least one, and
+                                          // at most "count" items;
+                                          // returns how many
+
     void Apply(void (*f)(T));  // apply function to all elements in list
 
     void SelfTest(T value);  // test the SynchList implementation
 
    private:
-    List<T> *list;         // the list of things
+    List<T> *list;         // the list of things, if unbounded
+    T *ring;               // the things, if bounded
+    int capacity;          // size of "ring"; 0 if unbounded
+    int first;             // index in "ring" of the front item
+    int numItems;          // number of items in "ring"
     Lock *lock;            // enforce mutual exclusive access to the list
     Condition *listEmpty;  // wait in Remove if the list is empty
+    Condition *listFull;   // wait in Append if the list is full
+
+    bool IsEmpty();   // these are called with the lock held
+    bool IsFull();
+    void Put(T item);
+    T Get();
 
     // these are only to assist SelfTest()
+    static const int SelfTestBatch = 8;
     SynchList<T> *selfTestPing;
     static void SelfTestHelper(void *data);
+    static void SelfTestBatchHelper(void *data);
 };
 
 #include "synchlist.cc"
@@ -39,6 +39,17 @@ Thread::Thread(char *threadName, int threadID)
         resetAccumTick(false) {
     ID = threadID;
     name = threadName;
+    priority = 0;
+    inheritedPriority = -1;
+    waitingOn = NULL;
+    waitStart = 0;
+    heldLocks = new List<Lock *>;
+    priorityUptTick = 0;
+    startRunningTick = 0;
+    quantum = 0;
+    quantumLevel = -1;  // no slice yet; refilled when first scheduled
+    remainingQuantum = 0;
+    realTime = NULL;
     isExec = false;
     stackTop = NULL;
     stack = NULL;
@@ -48,6 +59,8 @@ Thread::Thread(char *threadName, int threadID)
                                  // of machine registers
     }
     space = NULL;
+    process = NULL;
+    userThread = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -65,12 +78,72 @@ Thread::Thread(char *threadName, int threadID)
 Thread::~Thread() {
     DEBUG(dbgThread, "Deleting thread: " << name);
     ASSERT(this != kernel->currentThread);
-    if (space != NULL) {
+    delete realTime;
+    delete heldLocks;
+    if (process != NULL) {  // the process owns the address space
+        if (process->RemoveThread(this)) {
+            kernel->processTable->Destroy(process);
+        }
+    } else if (space != NULL) {
         DEBUG(dbgThread, "Deleting addr space for " << name);
         delete space;
     }
-    if (stack != NULL)
-        DeallocBoundedArray((char *)stack, StackSize * sizeof(int));
+    if (stack != NULL) {
+        if (stackPoolCount < StackPoolSize) {
+            stackPool[stackPoolCount++] = stack;  // keep it for the next Fork
+        } else {
+            DeallocBoundedArray((char *)stack, StackSize * sizeof(int));
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Thread::operator new, Thread::operator delete
+// 	Recycle the storage of Thread objects through a bounded free
+//	list, so that short-lived threads do not go to the host heap.
+//	Interrupts need not be off: nothing here can cause a context
+//	switch.
+//----------------------------------------------------------------------
+
+int *Thread::stackPool[StackPoolSize];
+int Thread::stackPoolCount = 0;
+void *Thread::threadPool[ThreadPoolSize];
+int Thread::threadPoolCount = 0;
+int Thread::numStackAllocs = 0;
+int Thread::numStackReuses = 0;
+int Thread::numThreadAllocs = 0;
+int Thread::numThreadReuses = 0;
+
+void *
+Thread::operator new(size_t size) {
+    ASSERT(size == sizeof(Thread));
+    if (threadPoolCount > 0) {
+        numThreadReuses++;
+        return threadPool[--threadPoolCount];
+    }
+    numThreadAllocs++;
+    return ::operator new(size);
+}
+
+void Thread::operator delete(void *ptr) {
+    if (threadPoolCount < ThreadPoolSize) {
+        threadPool[threadPoolCount++] = ptr;
+    } else {
+        ::operator delete(ptr);
+    }
+}
+
+//----------------------------------------------------------------------
+// Thread::PrintPoolStats
+// 	Report how often stacks and Thread objects came from the pools
+//	rather than from the host allocator.
+//----------------------------------------------------------------------
+
+void Thread::PrintPoolStats() {
+    cout << "Thread stacks: allocated " << numStackAllocs << ", reused "
+         << numStackReuses << ", pooled " << stackPoolCount << "\n";
+    cout << "Thread objects: allocated " << numThreadAllocs << ", reused "
+         << numThreadReuses << ", pooled " << threadPoolCount << "\n";
 }
 
 //----------------------------------------------------------------------
@@ -174,6 +247,9 @@ void Thread::Finish() {
     ASSERT(this == kernel->currentThread);
 
     DEBUG(dbgThread, "Finishing thread: " << name);
+    if (IsRealTime()) {
+        kernel->scheduler->LeaveRealTime(this);
+    }
     if (kernel->execExit && this->getIsExec()) {
         kernel->execRunningNum--;
         if (kernel->execRunningNum == 0) {
@@ -210,10 +286,17 @@ void Thread::Yield() {
 
     DEBUG(dbgThread, "Yielding thread: " << name);
 
-    nextThread = kernel->scheduler->FindNextToRun();
-    if (nextThread != NULL) {
-        kernel->scheduler->ReadyToRun(this);
-        kernel->scheduler->Run(nextThread, FALSE);
+    if (IsThrottled()) {
+        // out of real-time budget: wait for the next period, even if
+        // that leaves the CPU idle
+        kernel->scheduler->Throttle(this);
+        Sleep(FALSE);
+    } else {
+        nextThread = kernel->scheduler->FindNextToRun();
+        if (nextThread != NULL) {
+            kernel->scheduler->ReadyToRun(this);
+            kernel->scheduler->Run(nextThread, FALSE);
+        }
     }
     (void)kernel->interrupt->SetLevel(oldLevel);
 }
@@ -300,12 +383,21 @@ PLabelToAddr(void *plabel) {
 //		calls (*func)(arg)
 //		calls Thread::Finish
 //
+//	A stack left over by a finished thread is reused if there is
+//	one; its guard pages are still in place.
+//
 //	"func" is the procedure to be forked
 //	"arg" is the parameter to be passed to the procedure
 //----------------------------------------------------------------------
 
 void Thread::StackAllocate(VoidFunctionPtr func, void *arg) {
-    stack = (int *)AllocBoundedArray(StackSize * sizeof(int));
+    if (stackPoolCount > 0) {
+        stack = stackPool[--stackPoolCount];
+        numStackReuses++;
+    } else {
+        stack = (int *)AllocBoundedArray(StackSize * sizeof(int));
+        numStackAllocs++;
+    }
 
 #ifdef PARISC
     // HP stack works from low addresses to high addresses
@@ -369,11 +461,15 @@ void Thread::StackAllocate(VoidFunctionPtr func, void *arg) {
 //	Note that a user program thread has *two* sets of CPU registers --
 //	one for its state while executing user code, one for its state
 //	while executing kernel code.  This routine saves the former.
+//
+//	A thread preempted inside its restartable atomic sequence is
+//	made to start it over when it runs again.
 //----------------------------------------------------------------------
 
 void Thread::SaveUserState() {
     for (int i = 0; i < NumTotalRegs; i++)
         userRegisters[i] = kernel->machine->ReadRegister(i);
+    space->RestartAtomicRegion(userRegisters);
 }
 
 //----------------------------------------------------------------------
@@ -390,6 +486,41 @@ void Thread::RestoreUserState() {
         kernel->machine->WriteRegister(i, userRegisters[i]);
 }
 
+//----------------------------------------------------------------------
+// Thread::CheckExiting
+//	If some thread of our process has called Exit, finish now.  This
+//	is only called on the way back to user code, where the thread
+//	holds nothing in the kernel: at the end of a system call, and
+//	after being preempted.
+//----------------------------------------------------------------------
+
+void Thread::CheckExiting() {
+    if (IsExiting()) {
+        process->FinishThread(process->exitStatus);
+        Finish();
+    }
+}
+
+//----------------------------------------------------------------------
+// Thread::IsExiting, Thread::SetCancelWait
+//	A system call which may block for good (until some other thread
+//	of the process does something) calls SetCancelWait before it
+//	checks IsExiting, and before it blocks; Exit then wakes the
+//	thread up by calling "canceller", and the call gives up once it
+//	sees IsExiting.  Threads not running a user program are never
+//	woken up this way.
+//----------------------------------------------------------------------
+
+bool Thread::IsExiting() {
+    return process != NULL && process->exiting;
+}
+
+void Thread::SetCancelWait(CallBackObj *canceller) {
+    if (userThread != NULL) {
+        userThread->cancelWait = canceller;
+    }
+}
+
 //----------------------------------------------------------------------
 // SimpleThread
 // 	Loop 5 times, yielding the CPU to another ready thread
@@ -444,14 +575,22 @@ ThreadStatus Thread::Status::setStatus(ThreadStatus st) {
         case READY:
             thread->priorityUptTick = kernel->stats->totalTicks;
             if (status == RUNNING) {
+                kernel->scheduler->ChargeRealTime(thread);
+                // preempted: keep whatever is left of the slice
+                thread->remainingQuantum -= thread->getRunningTick();
                 thread->accumRunningTick += thread->getRunningTick();
             }
             break;
         case RUNNING:
             thread->startRunningTick = kernel->stats->totalTicks;
+            if (thread->realTime != NULL) {
+                thread->realTime->chargeTick = kernel->stats->totalTicks;
+            }
             break;
         case BLOCKED: {
             double temp = thread->approBurstTick;
+            kernel->scheduler->ChargeRealTime(thread);
+            kernel->scheduler->QuantumYielded(thread);
             thread->accumRunningTick += thread->getRunningTick();
             thread->approBurstTick = 0.5 * temp + 0.5 * thread->accumRunningTick;
             DEBUG(dbgScheduler, "[D] Tick [" << kernel->stats->totalTicks <<
@@ -39,10 +39,16 @@
 
 #include "addrspace.h"
 #include "copyright.h"
+#include "list.h"
 #include "machine.h"
 #include "sysdep.h"
 #include "utility.h"
 
+class Process;
+class UserThread;
+class CallBackObj;
+class Lock;
+
 // CPU register state to be saved on context switch.
 // The x86 needs to save only a few registers,
 // SPARC and MIPS needs to save 10 registers,
@@ -56,6 +62,12 @@
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 const int StackSize = (8 * 1024);  // in words
 
+// Finished threads hand their stack and their control block back to a
+// pool instead of the host allocator, so that forking a thread in the
+// steady state does not allocate (or mprotect) anything.
+const int StackPoolSize = 32;   // max. number of idle stacks kept
+const int ThreadPoolSize = 32;  // max. number of idle Thread objects kept
+
 // Thread state
 enum ThreadStatus { JUST_CREATED,
                     RUNNING,
@@ -63,6 +75,20 @@ enum ThreadStatus { JUST_CREATED,
                     BLOCKED,
                     ZOMBIE };
 
+// Parameters and state of a thread in the real-time (EDF) scheduling
+// class; see Scheduler::SetRealTime.  All times are in ticks.
+
+struct RealTimeParams {
+    int period;       // a new job is released every "period" ticks
+    int budget;       // CPU time each job may use
+    int deadline;     // relative to the job's release
+    int budgetLeft;   // CPU time left for the current job
+    int absDeadline;  // deadline of the current job
+    int nextRelease;  // when the next job is released
+    int chargeTick;   // when budgetLeft was last charged
+    bool missed;      // has the current job been counted as a miss?
+};
+
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
 //
@@ -116,12 +142,28 @@ class Thread {
     char *getName() { return (name); }
 
     int getID() { return (ID); }
-    int getPriority() { return priority; }
+    int getPriority() {  // effective priority, including inheritance
+        return max(priority, inheritedPriority);
+    }
+    int getBasePriority() { return priority; }
     void setPriority(int value) { priority = value; }
+    int getInheritedPriority() { return inheritedPriority; }
+    void setInheritedPriority(int value) { inheritedPriority = value; }
+    Lock *getWaitingOn() { return waitingOn; }
+    void setWaitingOn(Lock *lock) { waitingOn = lock; }
+    int getWaitStart() { return waitStart; }
+    void setWaitStart(int tick) { waitStart = tick; }
+    List<Lock *> *getHeldLocks() { return heldLocks; }
     int getPriorityUptTick() { return priorityUptTick; }
     void setPriorityUptTick(int value) { priorityUptTick = value; }
     int getRunningTick();
     double getApproRemainingTick();
+    int getQuantum() { return quantum; }
+    void setQuantum(int value) { quantum = value; }
+    int getQuantumLevel() { return quantumLevel; }
+    void setQuantumLevel(int value) { quantumLevel = value; }
+    int getRemainingQuantum() { return remainingQuantum; }
+    void setRemainingQuantum(int value) { remainingQuantum = value; }
     double getApproBurstTick() { return approBurstTick; }
     int getAccumTickWithResetCheck() {
         int ret = accumRunningTick;
@@ -131,11 +173,20 @@ class Thread {
         }
         return ret;
     }
+    RealTimeParams *getRealTime() { return realTime; }
+    void setRealTime(RealTimeParams *params) { realTime = params; }
+    bool IsRealTime() { return realTime != NULL; }
+    bool IsThrottled() { return realTime != NULL && realTime->budgetLeft <= 0; }
     void setIsExec() { this->isExec = true; }
     bool getIsExec() { return (isExec); }
     void Print() { cout << name; }
     void SelfTest();  // test whether thread impl is working
 
+    // Thread control blocks come from a free list (see ThreadPoolSize)
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr);
+    static void PrintPoolStats();  // print stack/thread pool usage
+
    private:
     // some of the private data for this class is listed above
 
@@ -145,16 +196,32 @@ class Thread {
     Status status;  // ready, running or blocked
     char *name;
     int ID;
-    int priority;
+    int priority;           // base priority (changed by aging)
+    int inheritedPriority;  // highest priority donated through the
+                            // locks we hold, -1 if none
+    Lock *waitingOn;        // lock we are blocked on, if any
+    int waitStart;          // when we started waiting for it
+    List<Lock *> *heldLocks;  // locks we currently hold
     int priorityUptTick;
     int startRunningTick, accumRunningTick;
     bool resetAccumTick;
     double approBurstTick;
+    int quantum;           // length of a full time slice for this thread
+    int quantumLevel;      // queue level "quantum" was computed for
+    int remainingQuantum;  // slice left as of startRunningTick
+    RealTimeParams *realTime;  // NULL unless in the real-time class
     bool isExec;  // Is this thread an user executable thread
     void StackAllocate(VoidFunctionPtr func, void *arg);
     // Allocate a stack for thread.
     // Used internally by Fork()
 
+    static int *stackPool[StackPoolSize];     // idle stacks
+    static int stackPoolCount;
+    static void *threadPool[ThreadPoolSize];  // idle Thread storage
+    static int threadPoolCount;
+    static int numStackAllocs, numStackReuses;    // pool statistics
+    static int numThreadAllocs, numThreadReuses;
+
     // A thread running a user program actually has *two* sets of CPU registers --
     // one for its state while executing user code, one for its state
     // while executing kernel code.
@@ -164,8 +231,15 @@ class Thread {
    public:
     void SaveUserState();     // save user-level register state
     void RestoreUserState();  // restore user-level register state
+    void CheckExiting();      // finish if our process is exiting
+    bool IsExiting();         // ... is it?
+    void SetCancelWait(CallBackObj *canceller);
+    // how Exit wakes us up while blocked
+    // in a system call; NULL once done
 
     AddrSpace *space;  // User code this thread is running.
+    Process *process;  // The process this thread belongs to, if any.
+    UserThread *userThread;  // ... and its record there
 };
 
 // external function, dummy routine whose sole job is to call Thread::Print
@@ -18,41 +18,11 @@
 #include "addrspace.h"
 
 #include "copyright.h"
+#include "imagecache.h"
 #include "machine.h"
 #include "main.h"
-#include "noff.h"
-
-//----------------------------------------------------------------------
-// SwapHeader
-// 	Do little endian to big endian conversion on the bytes in the
-//	object file header, in case the file was generated on a little
-//	endian machine, and we're now running on a big endian machine.
-//----------------------------------------------------------------------
-
-static void
-SwapHeader(NoffHeader *noffH) {
-    noffH->noffMagic = WordToHost(noffH->noffMagic);
-    noffH->code.size = WordToHost(noffH->code.size);
-    noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
-    noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
-#ifdef RDATA
-    noffH->readonlyData.size = WordToHost(noffH->readonlyData.size);
-    noffH->readonlyData.virtualAddr =
-        WordToHost(noffH->readonlyData.virtualAddr);
-    noffH->readonlyData.inFileAddr =
-        WordToHost(noffH->readonlyData.inFileAddr);
-#endif
-    noffH->initData.size = WordToHost(noffH->initData.size);
-    noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
-    noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
-    noffH->uninitData.size = WordToHost(noffH->uninitData.size);
-    noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
-    noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
-
-#ifdef RDATA
-    DEBUG(dbgAddr, "code = " << noffH->code.size << " readonly = " << noffH->readonlyData.size << " init = " << noffH->initData.size << " uninit = " << noffH->uninitData.size << "\n");
-#endif
-}
+#include "shm.h"
+#include "syscall.h"
 
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
@@ -62,112 +32,140 @@ SwapHeader(NoffHeader *noffH) {
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace() {
+    pageTable = NULL;
+    numPages = 0;
+    copyOnWrite = NULL;
+    image = NULL;
+    argCount = 0;
+    args = NULL;
+    atomicBegin = atomicEnd = 0;  // no restartable sequence
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.
+// 	Dealloate an address space.  Shared memory segments still
+//	attached are detached first.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace() {
     DEBUG(dbgSys, "Release pages of the addrspace.");
+    kernel->shmTable->DetachAll(this);
     for (int i = 0; i < numPages; i++) {
-        kernel->ReleasePage(pageTable[i].physicalPage);
+        if (pageTable[i].valid) {
+            kernel->ReleasePage(pageTable[i].physicalPage);
+        }
+    }
+    delete[] pageTable;
+    delete[] copyOnWrite;
+    if (image != NULL) {
+        image->Release();
     }
-    delete pageTable;
+    for (int i = 0; i < argCount; i++) {
+        delete[] args[i];
+    }
+    delete[] args;
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::Load
-// 	Load a user program into memory from a file.
+// 	Load a user program into memory, from the copy of its file kept
+//	by the image cache (which reads the file the first time).
 //
-//	Assumes that the page table has been initialized, and that
-//	the object code file is in NOFF format.
+//	Code pages already loaded by a running instance of the same
+//	program are shared with it, read-only.  Every other page gets a
+//	fresh, zeroed frame, and the code and data are copied into it.
 //
 //	"fileName" is the file containing the object code to load into memory
+//
+//	Returns 0, or ENOENT if there is no such file, ENOEXEC if it is
+//	not a NOFF file, or ENOMEM if there are not enough free frames.
 //----------------------------------------------------------------------
 
-bool AddrSpace::Load(char *fileName) {
-    OpenFile *executable = kernel->fileSystem->Open(fileName);
-    NoffHeader noffH;
-    unsigned int size;
+int AddrSpace::Load(char *fileName) {
+    int error;
+    ProgramImage *program = kernel->imageCache->Get(fileName, &error);
+    NoffHeader *noffH;
 
-    if (executable == NULL) {
-        cerr << "Unable to open file " << fileName << "\n";
-        return FALSE;
+    if (program == NULL) {
+        cerr << "Unable to load file " << fileName << "\n";
+        return error;
     }
+    noffH = &program->header;
 
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) &&
-        (WordToHost(noffH.noffMagic) == NOFFMAGIC))
-        SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
-
-#ifdef RDATA
-    // how big is address space?
-    size = noffH.code.size + noffH.readonlyData.size + noffH.initData.size +
-           noffH.uninitData.size + UserStackSize;
-    // we need to increase the size
-    // to leave room for the stack
-#else
-    // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size + UserStackSize;  // we need to increase the size
-                                                                                           // to leave room for the stack
-#endif
-    numPages = divRoundUp(size, PageSize);
-    size = numPages * PageSize;
-
-    if (!kernel->CanAllocatePages(numPages)) { // Make sure phys memory has enough unused pages to store the program
+    if (!kernel->CanAllocatePages(program->numPages - program->NumSharedPages())) { // Make sure phys memory has enough unused pages to store the program
         DEBUG(dbgSys, "There's no space for this program!");
-        delete executable;
-        ExceptionHandler(MemoryLimitException);
-        return FALSE;
+        return ENOMEM;
     }
 
+    numPages = program->numPages;
     pageTable = new TranslationEntry[numPages];
-    int virtNum = 0;
-    for (int i = 0; i < NumPhysPages && virtNum < numPages; i++) {
-        if (kernel->AllocatePage(i)) { // If page's allocated successfully then add to the page table
-            DEBUG(dbgSys, "Allocate phys page " << i << " as virt page " << virtNum);
-            pageTable[virtNum].virtualPage = virtNum;
-            pageTable[virtNum].physicalPage = i;
-            pageTable[virtNum].valid = TRUE;
-            pageTable[virtNum].use = FALSE;
-            pageTable[virtNum].dirty = FALSE;
-            pageTable[virtNum].readOnly = FALSE;
-            bzero(kernel->machine->mainMemory + i * PageSize, PageSize); // zero out spaces in certain physical page #i
-            virtNum++;
+    copyOnWrite = new bool[numPages];
+    for (unsigned int vpn = 0; vpn < numPages; vpn++) {
+        TranslationEntry *pte = &pageTable[vpn];
+
+        copyOnWrite[vpn] = FALSE;
+
+        pte->virtualPage = vpn;
+        pte->valid = TRUE;
+        pte->use = FALSE;
+        pte->dirty = FALSE;
+        if (program->textFrames[vpn] >= 0) {  // code another instance loaded
+            pte->physicalPage = program->textFrames[vpn];
+            pte->readOnly = TRUE;
+            kernel->SharePage(pte->physicalPage);
+            DEBUG(dbgSys, "Share phys page " << pte->physicalPage << " as virt page " << vpn);
+        } else {
+            pte->physicalPage = kernel->AllocateFreePage();
+            pte->readOnly = FALSE;
+            bzero(kernel->machine->mainMemory + pte->physicalPage * PageSize, PageSize); // zero out spaces in the physical page
+            DEBUG(dbgSys, "Allocate phys page " << pte->physicalPage << " as virt page " << vpn);
         }
     }
-    DEBUG(dbgSys, "Initializing address space: " << numPages << ", " << size);
+    DEBUG(dbgSys, "Initializing address space: " << numPages << ", " << numPages * PageSize);
+
+    // then, copy in the code and data segments into memory using LoadSegment
 
-    // then, copy in the code and data segments into memory using LoadDataSegment
-    
-    LoadDataSegment(executable, noffH.code.virtualAddr, noffH.code.inFileAddr, noffH.code.size, 1);
-    LoadDataSegment(executable, noffH.initData.virtualAddr, noffH.initData.inFileAddr, noffH.initData.size, 1);
+    LoadSegment(program->contents, noffH->code.virtualAddr, noffH->code.inFileAddr, noffH->code.size);
+    LoadSegment(program->contents, noffH->initData.virtualAddr, noffH->initData.inFileAddr, noffH->initData.size);
 #ifdef RDATA
-    LoadDataSegment(executable, noffH.readonlyData.virtualAddr, noffH.readonlyData.inFileAddr, noffH.readonlyData.size, 0);
+    LoadSegment(program->contents, noffH->readonlyData.virtualAddr, noffH->readonlyData.inFileAddr, noffH->readonlyData.size);
 #endif
 
-    delete executable;  // close file
-    return TRUE;        // success
+    // from now on, the next instance can share our code pages
+    for (unsigned int vpn = 0; vpn < numPages; vpn++) {
+        if (program->IsTextPage(vpn)) {
+            pageTable[vpn].readOnly = TRUE;
+            program->textFrames[vpn] = pageTable[vpn].physicalPage;
+        }
+    }
+    program->users++;
+    image = program;
+    return 0;  // success
 }
 
-ExceptionType AddrSpace::LoadDataSegment(OpenFile* executable, int virtualAddr, int inFileAddr, int segmentSize, int isReadWrite) {
-    unsigned int readBegin = 0, readEnd = ((virtualAddr / PageSize) + 1) * PageSize - virtualAddr; // the distance between virtualAddr & end position of the page where virtualAddr is at.
-    while (readBegin < segmentSize) {
-        unsigned int physAddr;
-        ExceptionType exception = Translate((virtualAddr + readBegin), &physAddr, isReadWrite);
-        if (exception != NoException) {
-            return exception;
-        }
+//----------------------------------------------------------------------
+// AddrSpace::LoadSegment
+// 	Copy a segment of the program from "contents", the program's
+//	file, into memory, a page at a time.  Shared code pages already
+//	hold their part of it, and are skipped.
+//----------------------------------------------------------------------
 
-        executable->ReadAt(&(kernel->machine->mainMemory[physAddr]), readEnd - readBegin, inFileAddr + readBegin);
+void AddrSpace::LoadSegment(char *contents, int virtualAddr, int inFileAddr, int segmentSize) {
+    int done = 0;
 
-        readBegin = readEnd;
-        readEnd = readEnd + PageSize > segmentSize ? segmentSize : readEnd + PageSize;
+    while (done < segmentSize) {
+        int vaddr = virtualAddr + done;
+        int chunk = min(segmentSize - done, PageSize - vaddr % PageSize);
+        TranslationEntry *pte = &pageTable[vaddr / PageSize];
+
+        ASSERT((unsigned int)vaddr / PageSize < numPages);
+        if (!pte->readOnly) {
+            bcopy(contents + inFileAddr + done,
+                  &kernel->machine->mainMemory[pte->physicalPage * PageSize + vaddr % PageSize],
+                  chunk);
+        }
+        done += chunk;
     }
-    return NoException;
 }
 
 //----------------------------------------------------------------------
@@ -192,6 +190,45 @@ void AddrSpace::Execute(char *fileName) {
                          // by doing the syscall "exit"
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::ExecuteThread
+// 	Run another thread of the program, already loaded: call "func",
+//	the thread's procedure, on the stack ending at "stackTop" (see
+//	AddStack).
+//
+//	The thread returns from "func" into a small piece of code the
+//	kernel writes at the top of its stack, which calls ThreadExit(0);
+//	old UNIX systems returned from signal handlers the same way.
+//----------------------------------------------------------------------
+
+void AddrSpace::ExecuteThread(int func, int stackTop) {
+    Machine *machine = kernel->machine;
+    unsigned int trampoline[3];
+    bool ok;
+
+    kernel->currentThread->space = this;
+    trampoline[0] = WordToMachine(0x24040000);  // addiu $4,$0,0
+    trampoline[1] = WordToMachine(0x24020000 | SC_ThreadExit);
+                                                // addiu $2,$0,SC_ThreadExit
+    trampoline[2] = WordToMachine(0x0000000c);  // syscall
+    ok = CopyOut(stackTop - 16, (char *)trampoline, sizeof(trampoline));
+    ASSERT(ok);
+
+    for (int i = 0; i < NumTotalRegs; i++)
+        machine->WriteRegister(i, 0);
+    machine->WriteRegister(PCReg, func);
+    machine->WriteRegister(NextPCReg, func + 4);
+    machine->WriteRegister(RetAddrReg, stackTop - 16);
+    machine->WriteRegister(StackReg, stackTop - 32);
+    DEBUG(dbgAddr, "Starting thread at " << func << ", stack pointer: " << stackTop - 32);
+    this->RestoreState();  // load page table register
+
+    machine->Run();  // jump to the user progam
+
+    ASSERTNOTREACHED();  // the thread exits by doing the syscall
+                         // "ThreadExit" (or "Exit")
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::InitRegisters
 // 	Set the initial values for the user-level register set.
@@ -224,6 +261,59 @@ void AddrSpace::InitRegisters() {
     // accidentally reference off the end!
     machine->WriteRegister(StackReg, numPages * PageSize - 16);
     DEBUG(dbgAddr, "Initializing stack pointer: " << numPages * PageSize - 16);
+
+    if (argCount > 0) {
+        PushArguments();
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SetArguments
+// 	Remember the arguments to pass to main(), for InitRegisters.
+//	The strings are copied.
+//----------------------------------------------------------------------
+
+void AddrSpace::SetArguments(int argc, char **argv) {
+    ASSERT(args == NULL);
+    argCount = argc;
+    args = new char *[argc];
+    for (int i = 0; i < argc; i++) {
+        args[i] = new char[strlen(argv[i]) + 1];
+        strcpy(args[i], argv[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PushArguments
+// 	Copy the arguments onto the top of the user stack: the strings,
+//	then the argv array pointing to them (ending with a NULL), and
+//	pass argc and argv to main() in r4 and r5.  The stack pointer is
+//	moved below them, leaving the 16 bytes the MIPS calling
+//	convention reserves for the callee.
+//----------------------------------------------------------------------
+
+void AddrSpace::PushArguments() {
+    Machine *machine = kernel->machine;
+    int sp = numPages * PageSize - 16;
+    int *argv = new int[argCount + 1];
+    bool ok = TRUE;
+
+    for (int i = argCount - 1; i >= 0; i--) {
+        int length = strlen(args[i]) + 1;
+        sp -= length;
+        ok = ok && CopyOut(sp, args[i], length);
+        argv[i] = WordToMachine(sp);
+    }
+    argv[argCount] = 0;
+    sp = (sp & ~0x3) - (argCount + 1) * 4;
+    ok = ok && CopyOut(sp, (char *)argv, (argCount + 1) * 4);
+    ASSERT(ok);  // the stack is big enough, see MaxExecArgs
+    delete[] argv;
+
+    machine->WriteRegister(4, argCount);
+    machine->WriteRegister(5, sp);
+    machine->WriteRegister(StackReg, sp - 16);
+    DEBUG(dbgAddr, "Passed " << argCount << " arguments, stack pointer: " << sp - 16);
 }
 
 //----------------------------------------------------------------------
@@ -249,12 +339,375 @@ void AddrSpace::RestoreState() {
     kernel->machine->pageTableSize = numPages;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::CopyIn
+// 	Copy "size" bytes at user address "vaddr" into "buffer".  The
+//	pages of the address space need not be contiguous in physical
+//	memory, so this goes a page at a time.
+//
+//	Returns FALSE if part of the range is not in the address space.
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyIn(int vaddr, char *buffer, int size) {
+    unsigned int paddr;
+    int chunk;
+
+    while (size > 0) {
+        if (vaddr < 0 || Translate(vaddr, &paddr, 0) != NoException) {
+            return FALSE;
+        }
+        chunk = min(size, PageSize - vaddr % PageSize);
+        bcopy(&kernel->machine->mainMemory[paddr], buffer, chunk);
+        vaddr += chunk;
+        buffer += chunk;
+        size -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOut
+// 	Copy "size" bytes from "buffer" to user address "vaddr".
+//
+//	Returns FALSE if part of the range is not in the address space
+//	(what comes before it has been copied).
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyOut(int vaddr, char *buffer, int size) {
+    unsigned int paddr;
+    int chunk;
+
+    while (size > 0) {
+        if (vaddr < 0 || Translate(vaddr, &paddr, 1) != NoException) {
+            return FALSE;
+        }
+        chunk = min(size, PageSize - vaddr % PageSize);
+        bcopy(buffer, &kernel->machine->mainMemory[paddr], chunk);
+        vaddr += chunk;
+        buffer += chunk;
+        size -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyInString
+// 	Copy the null-terminated string at user address "vaddr" into
+//	"buffer", which has room for "maxLength" bytes.
+//
+//	Returns the length of the string, or -1 if it runs outside the
+//	address space or doesn't fit.
+//----------------------------------------------------------------------
+
+int AddrSpace::CopyInString(int vaddr, char *buffer, int maxLength) {
+    unsigned int paddr;
+
+    for (int i = 0; i < maxLength; i++) {
+        if (vaddr + i < 0 || Translate(vaddr + i, &paddr, 0) != NoException) {
+            return -1;
+        }
+        buffer[i] = kernel->machine->mainMemory[paddr];
+        if (buffer[i] == '\0') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ExchangeFrame
+//	Map the page holding "vaddr" to physical page "frame" instead of
+//	the one it is mapped to now, which is returned (the caller owns
+//	it from now on).  If "frame" is shared, the page is mapped
+//	copy-on-write.  Returns -1, changing nothing, if "vaddr" is not
+//	in a writable, private page of the address space.
+//----------------------------------------------------------------------
+
+int AddrSpace::ExchangeFrame(int vaddr, int frame) {
+    unsigned int vpn = (unsigned int)vaddr / PageSize;
+    int replaced;
+
+    if (vpn >= numPages || !pageTable[vpn].valid || pageTable[vpn].readOnly ||
+        kernel->IsPageShared(pageTable[vpn].physicalPage)) {
+        return -1;
+    }
+    replaced = pageTable[vpn].physicalPage;
+    pageTable[vpn].physicalPage = frame;
+    if (kernel->IsPageShared(frame)) {
+        pageTable[vpn].readOnly = TRUE;
+        copyOnWrite[vpn] = TRUE;
+    }
+    DEBUG(dbgAddr, "Virtual page " << vpn << " moved from frame " << replaced
+                                   << " to " << frame);
+    return replaced;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoanFrame
+//	Share the frame holding the page at "vaddr" with the caller,
+//	which gets a reference of its own to it.  The page stays mapped,
+//	but read-only, until it is next written to; then it is copied
+//	(see BreakCopyOnWrite), so the caller's copy never changes.
+//
+//	Returns the frame, or -1 if the page is not a writable, private
+//	page (or one already copy-on-write) of the address space.
+//----------------------------------------------------------------------
+
+int AddrSpace::LoanFrame(int vaddr) {
+    unsigned int vpn = (unsigned int)vaddr / PageSize;
+    TranslationEntry *pte;
+
+    if (vpn >= numPages || !pageTable[vpn].valid) {
+        return -1;
+    }
+    pte = &pageTable[vpn];
+    if (!copyOnWrite[vpn] &&
+        (pte->readOnly || kernel->IsPageShared(pte->physicalPage))) {
+        return -1;
+    }
+    kernel->SharePage(pte->physicalPage);
+    pte->readOnly = TRUE;
+    copyOnWrite[vpn] = TRUE;
+    DEBUG(dbgAddr, "Virtual page " << vpn << " loaned, frame " << pte->physicalPage);
+    return pte->physicalPage;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::BreakCopyOnWrite
+//	Page "vpn" is about to be written to.  If it is copy-on-write,
+//	make it writable again, first copying it to a fresh frame if
+//	its frame is still shared.
+//
+//	Returns FALSE if the page is not copy-on-write, or there is no
+//	free frame to copy it to.
+//----------------------------------------------------------------------
+
+bool AddrSpace::BreakCopyOnWrite(unsigned int vpn) {
+    TranslationEntry *pte;
+
+    if (vpn >= numPages || !pageTable[vpn].valid || !copyOnWrite[vpn]) {
+        return FALSE;
+    }
+    pte = &pageTable[vpn];
+    if (kernel->IsPageShared(pte->physicalPage)) {
+        int fresh = kernel->AllocateFreePage();
+        char *mainMemory = kernel->machine->mainMemory;
+
+        if (fresh < 0) {
+            return FALSE;
+        }
+        bcopy(mainMemory + pte->physicalPage * PageSize,
+              mainMemory + fresh * PageSize, PageSize);
+        kernel->ReleasePage(pte->physicalPage);
+        DEBUG(dbgAddr, "Virtual page " << vpn << " copied from frame "
+                                       << pte->physicalPage << " to " << fresh);
+        pte->physicalPage = fresh;
+    }
+    pte->readOnly = FALSE;
+    copyOnWrite[vpn] = FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapShared
+//	Map the "count" frames in "frames" at user address "vaddr", which
+//	must be page aligned; 0 means right after the end of the address
+//	space.  The page table grows as needed.  Each frame gets one more
+//	reference, dropped by UnmapShared.
+//
+//	Returns the address used, or -1 if the address is bad or a page
+//	in the range is already mapped.
+//----------------------------------------------------------------------
+
+int AddrSpace::MapShared(int vaddr, int *frames, int count) {
+    unsigned int first, last;
+
+    if (vaddr == 0) {
+        vaddr = numPages * PageSize;
+    }
+    if (vaddr < 0 || vaddr % PageSize != 0 || count <= 0) {
+        return -1;
+    }
+    first = vaddr / PageSize;
+    last = first + count;
+    for (unsigned int vpn = first; vpn < last && vpn < numPages; vpn++) {
+        if (pageTable[vpn].valid) {
+            return -1;
+        }
+    }
+    if (last > numPages) {
+        GrowPageTable(last);
+    }
+    for (int i = 0; i < count; i++) {
+        TranslationEntry *pte = &pageTable[first + i];
+
+        kernel->SharePage(frames[i]);
+        pte->physicalPage = frames[i];
+        pte->valid = TRUE;
+        pte->readOnly = FALSE;
+        copyOnWrite[first + i] = FALSE;
+        pte->use = pte->dirty = FALSE;
+    }
+    DEBUG(dbgAddr, "Mapped " << count << " shared pages at " << vaddr);
+    return vaddr;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UnmapShared
+//	Undo MapShared: unmap "count" pages from user address "vaddr".
+//----------------------------------------------------------------------
+
+void AddrSpace::UnmapShared(int vaddr, int count) {
+    for (unsigned int vpn = vaddr / PageSize; count > 0; vpn++, count--) {
+        ASSERT(vpn < numPages && pageTable[vpn].valid);
+        kernel->ReleasePage(pageTable[vpn].physicalPage);
+        pageTable[vpn].valid = FALSE;
+    }
+    DEBUG(dbgAddr, "Unmapped shared pages at " << vaddr);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddStack
+//	Make a stack for another thread: ThreadStackPages fresh, zeroed
+//	pages, in the first big enough hole above the program (where a
+//	stack of a thread gone may have been), or else at the end of the
+//	address space.
+//
+//	Returns the address just above the stack, or -1 if there are not
+//	enough free frames.
+//----------------------------------------------------------------------
+
+int AddrSpace::AddStack() {
+    unsigned int first = image->numPages, run = 0;
+
+    if (!kernel->CanAllocatePages(ThreadStackPages)) {
+        return -1;
+    }
+    while (run < ThreadStackPages && first + run < numPages) {
+        if (pageTable[first + run].valid) {  // start over past it
+            first += run + 1;
+            run = 0;
+        } else {
+            run++;
+        }
+    }
+    if (first + ThreadStackPages > numPages) {
+        GrowPageTable(first + ThreadStackPages);
+    }
+    for (unsigned int vpn = first; vpn < first + ThreadStackPages; vpn++) {
+        TranslationEntry *pte = &pageTable[vpn];
+
+        pte->physicalPage = kernel->AllocateFreePage();
+        pte->valid = TRUE;
+        pte->readOnly = FALSE;
+        pte->use = pte->dirty = FALSE;
+        copyOnWrite[vpn] = FALSE;
+        bzero(kernel->machine->mainMemory + pte->physicalPage * PageSize, PageSize);
+    }
+    DEBUG(dbgAddr, "Thread stack at pages " << first << " to " << first + ThreadStackPages - 1);
+    return (first + ThreadStackPages) * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RemoveStack
+//	Free the stack of a thread which is gone: the one ending at
+//	"stackTop", as returned by AddStack.
+//----------------------------------------------------------------------
+
+void AddrSpace::RemoveStack(int stackTop) {
+    unsigned int last = stackTop / PageSize;
+
+    for (unsigned int vpn = last - ThreadStackPages; vpn < last; vpn++) {
+        ASSERT(vpn < numPages && pageTable[vpn].valid);
+        kernel->ReleasePage(pageTable[vpn].physicalPage);
+        pageTable[vpn].valid = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GrowPageTable
+//	Make room in the page table for "newNumPages" pages.  The new
+//	entries are invalid.  If the address space is running, tell the
+//	machine where the page table is now.
+//----------------------------------------------------------------------
+
+void AddrSpace::GrowPageTable(unsigned int newNumPages) {
+    TranslationEntry *newTable = new TranslationEntry[newNumPages];
+    bool *newCopyOnWrite = new bool[newNumPages];
+    bool running = (kernel->machine->pageTable == pageTable);
+
+    for (unsigned int vpn = 0; vpn < newNumPages; vpn++) {
+        if (vpn < numPages) {
+            newTable[vpn] = pageTable[vpn];
+            newCopyOnWrite[vpn] = copyOnWrite[vpn];
+        } else {
+            newCopyOnWrite[vpn] = FALSE;
+            newTable[vpn].virtualPage = vpn;
+            newTable[vpn].physicalPage = -1;
+            newTable[vpn].valid = FALSE;
+            newTable[vpn].readOnly = FALSE;
+            newTable[vpn].use = newTable[vpn].dirty = FALSE;
+        }
+    }
+    delete[] pageTable;
+    delete[] copyOnWrite;
+    pageTable = newTable;
+    copyOnWrite = newCopyOnWrite;
+    numPages = newNumPages;
+    if (running) {
+        RestoreState();
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SetAtomicRegion
+// 	Register the user code between "begin" and "end" as a
+//	restartable atomic sequence.  The simulated MIPS has no ll/sc
+//	instructions, so user-level locks use a short sequence which
+//	only updates memory with its last instruction; if the thread
+//	is switched out part way through, it starts the sequence over.
+//
+//	Returns FALSE if the region isn't a few aligned instructions
+//	inside the address space.
+//----------------------------------------------------------------------
+
+bool AddrSpace::SetAtomicRegion(int begin, int end) {
+    const int MaxAtomicRegion = 16 * 4;  // at most 16 instructions
+
+    if (begin < 0 || begin >= end || end - begin > MaxAtomicRegion ||
+        (begin & 0x3) != 0 || (end & 0x3) != 0 ||
+        (unsigned int)end > numPages * PageSize) {
+        return FALSE;
+    }
+    atomicBegin = begin;
+    atomicEnd = end;
+    DEBUG(dbgAddr, "Atomic region " << begin << " to " << end);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RestartAtomicRegion
+// 	Called when a thread of this address space is switched out,
+//	with its saved user registers.  If it was in the middle of the
+//	restartable sequence, make it resume from the beginning.
+//----------------------------------------------------------------------
+
+void AddrSpace::RestartAtomicRegion(int *registers) {
+    int pc = registers[PCReg];
+
+    if (pc > atomicBegin && pc < atomicEnd) {
+        registers[PCReg] = atomicBegin;
+        registers[NextPCReg] = atomicBegin + 4;
+    }
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::Translate
 //  Translate the virtual address in _vaddr_ to a physical address
 //  and store the physical address in _paddr_.
 //  The flag _isReadWrite_ is false (0) for read-only access; true (1)
-//  for read-write access.
+//  for read-write access.  A write to a copy-on-write page gives it
+//  a frame of its own first.
 //  Return any exceptions caused by the address translation.
 //----------------------------------------------------------------------
 ExceptionType
@@ -270,7 +723,10 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite) {
 
     pte = &pageTable[vpn];
 
-    if (isReadWrite && pte->readOnly) {
+    if (!pte->valid) {
+        return PageFaultException;
+    }
+    if (isReadWrite && pte->readOnly && !BreakCopyOnWrite(vpn)) {
         return ReadOnlyException;
     }
 
@@ -18,20 +18,36 @@
 #include "machine.h"
 
 #define UserStackSize 1024  // increase this as necessary!
+#define MaxExecArgs 16        // arguments ExecV passes to main()
+#define MaxExecArgBytes 512   // room they take on the stack, strings
+                              // and pointers together
+#define ThreadStackPages divRoundUp(UserStackSize, PageSize)
+                              // stack of each extra user thread
+
+class ProgramImage;
 
 class AddrSpace {
    public:
     AddrSpace();   // Create an address space.
     ~AddrSpace();  // De-allocate an address space
 
-    bool Load(char *fileName);  // Load a program into addr space from
-                                // a file
-                                // return false if not found
-   ExceptionType LoadDataSegment(OpenFile* executable, int virtualAddr, int inFileAddr, int segmentSize, int isReadWrite);
+    int Load(char *fileName);  // Load a program into addr space from
+                               // a file; returns 0, or ENOENT if not
+                               // found, ENOEXEC if not a program, or
+                               // ENOMEM if out of memory
+    void SetArguments(int argc, char **argv);  // for main(), before
+                                                // Execute
 
     void Execute(char *fileName);  // Run a program
                                    // assumes the program has already
                                    // been loaded
+    void ExecuteThread(int func, int stackTop);
+    // Run another thread of the program,
+    // from "func" on its own stack
+
+    int AddStack();  // stack for another thread; returns its
+                     // top, -1 if out of memory
+    void RemoveStack(int stackTop);  // ... and free it
 
     void SaveState();     // Save/restore address space-specific
     void RestoreState();  // info on a context switch
@@ -41,11 +57,49 @@ class AddrSpace {
     // is 0 for Read, 1 for Write.
     ExceptionType Translate(unsigned int vaddr, unsigned int *paddr, int mode);
 
+    // Copy data between the address space and the kernel, through
+    // the page table; FALSE (or -1) if an address is bad.
+    bool CopyIn(int vaddr, char *buffer, int size);
+    bool CopyOut(int vaddr, char *buffer, int size);
+    int Size() { return numPages * PageSize; }  // bytes addressable; no
+                                                // user buffer is larger
+    int CopyInString(int vaddr, char *buffer, int maxLength);
+    // returns the length, -1 if bad
+    // or longer than maxLength - 1
+
+    int ExchangeFrame(int vaddr, int frame);  // remap a page; returns
+                                              // the old frame, -1 if bad
+    int LoanFrame(int vaddr);  // share a page's frame, copy-on-write;
+                               // returns the frame, -1 if it can't be
+    bool BreakCopyOnWrite(unsigned int vpn);  // give a copy-on-write
+                                              // page a frame of its own;
+                                              // FALSE if out of memory
+    int MapShared(int vaddr, int *frames, int count);
+    // map shared frames at vaddr (0: at
+    // the end); returns vaddr, -1 if bad
+    void UnmapShared(int vaddr, int count);
+
+    bool SetAtomicRegion(int begin, int end);  // restartable user code
+    void RestartAtomicRegion(int *registers);  // on a context switch,
+                                               // back up the PC if in it
+
    private:
     TranslationEntry *pageTable;  // Assume linear page table translation
                                   // for now!
     unsigned int numPages;        // Number of pages in the virtual
                                   // address space
+    bool *copyOnWrite;            // by page: read-only only until
+                                  // written to (see LoanFrame)
+    int atomicBegin, atomicEnd;   // restartable sequence, if any
+
+    ProgramImage *image;          // the program loaded, or NULL
+    int argCount;                 // arguments for main()
+    char **args;
+
+    void LoadSegment(char *contents, int virtualAddr, int inFileAddr, int segmentSize);
+    void GrowPageTable(unsigned int newNumPages);  // for MapShared
+                                                   // and AddStack
+    void PushArguments();  // onto the stack, for main()
 
     void InitRegisters();  // Initialize user-level CPU registers,
                            // before jumping to user code
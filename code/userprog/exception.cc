@@ -4,8 +4,7 @@
 //	transfer back to here from user code:
 //
 //	syscall -- The user code explicitly requests to call a procedure
-//	in the Nachos kernel.  Right now, the only function we support is
-//	"Halt".
+//	in the Nachos kernel.
 //
 //	exceptions -- The user code does something that the CPU can't handle.
 //	For instance, accessing memory that doesn't exist, arithmetic errors,
@@ -14,8 +13,14 @@
 //	Interrupts (which can also cause control to transfer from user
 //	code into the Nachos kernel) are handled elsewhere.
 //
-// For now, this only handles the Halt() system call.
-// Everything else core dumps.
+// System calls are described by a table, indexed by system call code:
+// the name, the routine implementing it, and the type of each argument.
+// One common path gets the arguments out of the registers (copying
+// strings and buffers in and out of the user's address space), calls
+// the routine, returns its result in r2, and advances the PC.  Adding
+// a system call is just adding an entry to the table.
+//
+// Exceptions other than system calls core dump.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -25,6 +30,686 @@
 #include "ksyscall.h"
 #include "main.h"
 #include "syscall.h"
+
+const int MaxSyscallArgs = 4;       // in r4 to r7
+const int MaxStringArg = 256;       // longest string argument, with the '\0'
+
+// How the common entry path gets each argument of a system call.
+
+enum SyscallArgType {
+    IntArg,        // passed as is
+    StringArg,     // null-terminated string, copied in
+    InBufferArg,   // buffer the kernel reads, copied in; its size is
+                   // the next argument
+    OutBufferArg   // buffer the kernel fills in; its size is the next
+                   // argument, and as many bytes as the call returns
+                   // are copied out
+};
+
+union SyscallArg {
+    int value;     // IntArg
+    char *buffer;  // the kernel's copy of anything else
+};
+
+typedef int (*SyscallHandler)(SyscallArg *args);
+
+struct SyscallEntry {
+    int code;                               // SC_xxx
+    char *name;                             // for debugging
+    SyscallHandler handler;                 // does the work
+    bool hasResult;                         // return its value in r2?
+    int numArgs;
+    SyscallArgType argTypes[MaxSyscallArgs];
+};
+
+//----------------------------------------------------------------------
+// BufferSizeOk
+//	Could "size" be the size of a buffer in the caller's memory?
+//	Checked before the kernel allocates a copy of the buffer, so a
+//	huge size fails the call rather than the host.
+//----------------------------------------------------------------------
+
+static bool
+BufferSizeOk(int size) {
+    return size >= 0 && size <= kernel->currentThread->space->Size();
+}
+
+//----------------------------------------------------------------------
+// Syscall handlers
+//	One per system call: take the marshalled arguments, and call
+//	the kernel routine in ksyscall.h.
+//----------------------------------------------------------------------
+
+static int
+DoHalt(SyscallArg *args) {
+    DEBUG(dbgSys, "Shutdown, initiated by user program.\n");
+    SysHalt();
+    ASSERTNOTREACHED();
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// ExitProcess
+//	End the current process, with exit status "status": on Exit, or
+//	when a user program can't go on.
+//----------------------------------------------------------------------
+
+static void
+ExitProcess(int status) {
+    DEBUG(dbgAddr, "Program exit\n");
+    cout << "return value:" << status << endl;
+    Process *process = kernel->currentThread->process;
+    if (process != NULL) {
+        process->Exit(status);  // the other threads finish too
+    }
+    kernel->currentThread->Finish();
+    ASSERTNOTREACHED();
+}
+
+static int
+DoExit(SyscallArg *args) {
+    ExitProcess(args[0].value);
+    return 0;
+}
+
+static int
+DoPrintInt(SyscallArg *args) {
+    DEBUG(dbgTraCode, "In ExceptionHandler(), into SysPrintInt, " << kernel->stats->totalTicks);
+    SysPrintInt(args[0].value);
+    DEBUG(dbgTraCode, "In ExceptionHandler(), return from SysPrintInt, " << kernel->stats->totalTicks);
+    return 0;
+}
+
+static int
+DoMSG(SyscallArg *args) {
+    cout << args[0].buffer << endl;
+    SysHalt();
+    ASSERTNOTREACHED();
+    return 0;
+}
+
+static int
+DoAdd(SyscallArg *args) {
+    int result = SysAdd(args[0].value, args[1].value);
+
+    cout << "result is " << result << "\n";
+    return result;
+}
+
+static int
+DoCreate(SyscallArg *args) {
+    return SysCreate(args[0].buffer);
+}
+
+static int
+DoOpen(SyscallArg *args) {
+    return SysOpen(args[0].buffer);
+}
+
+//----------------------------------------------------------------------
+// DoWrite, DoRead
+//	Files are written and read through a kernel buffer.  Pipes get
+//	the user's address instead, so that whole pages can move by
+//	remapping frames (see pipe.h); that is why these two marshal
+//	their own buffers.
+//----------------------------------------------------------------------
+
+static int
+DoWrite(SyscallArg *args) {
+    int vaddr = args[0].value, size = args[1].value, id = args[2].value;
+    int result = EFAULT;
+    char *buffer;
+
+    if (SysIsPipe(id)) {
+        return SysWritePipe(vaddr, size, id);
+    }
+    if (!BufferSizeOk(size)) {
+        return EFAULT;
+    }
+    buffer = new char[max(size, 1)];
+    if (kernel->currentThread->space->CopyIn(vaddr, buffer, size)) {
+        result = SysWrite(buffer, size, id);
+    }
+    delete[] buffer;
+    return result;
+}
+
+static int
+DoRead(SyscallArg *args) {
+    int vaddr = args[0].value, size = args[1].value, id = args[2].value;
+    int result;
+    char *buffer;
+
+    if (SysIsPipe(id)) {
+        return SysReadPipe(vaddr, size, id);
+    }
+    if (!BufferSizeOk(size)) {
+        return EFAULT;
+    }
+    buffer = new char[max(size, 1)];
+    result = SysRead(buffer, size, id);
+    if (result > 0 && !kernel->currentThread->space->CopyOut(vaddr, buffer, result)) {
+        result = EFAULT;
+    }
+    delete[] buffer;
+    return result;
+}
+
+//----------------------------------------------------------------------
+// DoPipe
+//	Create a pipe, and store the ids of its read and write ends in
+//	the user's array of two OpenFileIds.
+//----------------------------------------------------------------------
+
+static int
+DoPipe(SyscallArg *args) {
+    OpenFileId ids[2];
+    int result = SysPipe(&ids[0], &ids[1]);
+
+    if (result == 0) {
+        ids[0] = WordToMachine(ids[0]);
+        ids[1] = WordToMachine(ids[1]);
+        if (!kernel->currentThread->space->CopyOut(args[0].value, (char *)ids, sizeof(ids))) {
+            SysClose(WordToHost(ids[0]));
+            SysClose(WordToHost(ids[1]));
+            result = EFAULT;
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------
+// DoGetRUsage
+//	Copy the counters out in the order of the RUsage fields.
+//----------------------------------------------------------------------
+
+static int
+DoGetRUsage(SyscallArg *args) {
+    ResourceUsage usage;
+    int result = SysGetRUsage(&usage);
+    int words[] = {usage.userTicks, usage.systemTicks, usage.instructions,
+                   usage.pageFaults, usage.diskReads, usage.diskWrites,
+                   usage.consoleCharsRead, usage.consoleCharsWritten,
+                   usage.contextSwitches, usage.elapsedTicks};
+
+    if (result == 0) {
+        for (int i = 0; i < (int)(sizeof(words) / sizeof(int)); i++) {
+            words[i] = WordToMachine(words[i]);
+        }
+        if (!kernel->currentThread->space->CopyOut(args[0].value, (char *)words,
+                                                   sizeof(words))) {
+            result = EFAULT;
+        }
+    }
+    return result;
+}
+
+static int
+DoSeek(SyscallArg *args) {
+    return SysSeek(args[0].value, args[1].value);
+}
+
+static int
+DoPWrite(SyscallArg *args) {
+    return SysPWrite(args[0].buffer, args[1].value, args[2].value, args[3].value);
+}
+
+static int
+DoIoSetup(SyscallArg *args) {
+    return SysIoSetup(args[0].value);
+}
+
+static int
+DoIoEnter(SyscallArg *args) {
+    return SysIoEnter(args[0].value, args[1].value);
+}
+
+static int
+DoShmCreate(SyscallArg *args) {
+    return SysShmCreate(args[0].value);
+}
+
+static int
+DoShmAttach(SyscallArg *args) {
+    return SysShmAttach(args[0].value, args[1].value);
+}
+
+static int
+DoShmDetach(SyscallArg *args) {
+    return SysShmDetach(args[0].value);
+}
+
+static int
+DoPRead(SyscallArg *args) {
+    return SysPRead(args[0].buffer, args[1].value, args[2].value, args[3].value);
+}
+
+static int
+DoThreadFork(SyscallArg *args) {
+    return SysThreadFork(args[0].value);
+}
+
+static int
+DoThreadYield(SyscallArg *args) {
+    SysThreadYield();
+    return 0;
+}
+
+static int
+DoThreadJoin(SyscallArg *args) {
+    return SysThreadJoin(args[0].value);
+}
+
+static int
+DoThreadExit(SyscallArg *args) {
+    SysThreadExit(args[0].value);
+    ASSERTNOTREACHED();
+    return 0;
+}
+
+static int
+DoExec(SyscallArg *args) {
+    return SysExec(args[0].buffer);
+}
+
+static int
+DoJoin(SyscallArg *args) {
+    return SysJoin(args[0].value);
+}
+
+//----------------------------------------------------------------------
+// DoExecV
+//	Copy in the argv array and the strings it points to.  They have
+//	to fit on the new program's stack: at most MaxExecArgs of them,
+//	taking MaxExecArgBytes in all.
+//----------------------------------------------------------------------
+
+static int
+DoExecV(SyscallArg *args) {
+    AddrSpace *space = kernel->currentThread->space;
+    int argc = args[0].value;
+    char *argv[MaxExecArgs];
+    int bytes = (argc + 1) * 4;
+    int result = 0, copied = 0;
+
+    if (argc < 1 || argc > MaxExecArgs) {
+        return argc < 1 ? EINVAL : E2BIG;
+    }
+    for (; copied < argc && result == 0; copied++) {
+        unsigned int word;
+        int length;
+
+        argv[copied] = new char[MaxStringArg];
+        if (!space->CopyIn(args[1].value + copied * 4, (char *)&word, 4)) {
+            result = EFAULT;
+        } else if ((length = space->CopyInString(WordToHost(word), argv[copied],
+                                                 MaxStringArg)) < 0) {
+            result = EFAULT;
+        } else if ((bytes += length + 1) > MaxExecArgBytes) {
+            result = E2BIG;
+        }
+    }
+    if (result == 0) {
+        result = SysExecV(argc, argv);
+    }
+    for (int i = 0; i < copied; i++) {
+        delete[] argv[i];
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------
+// GetIoVecs
+//	Copy in the array of "count" IoVecs at user address "vaddr" (as
+//	pairs of words: base, length), and add up the lengths.  Returns
+//	FALSE if the array, or a length, is bad, or if the lengths add
+//	up to more than the caller's memory could hold.
+//----------------------------------------------------------------------
+
+static bool
+GetIoVecs(int vaddr, int count, int *bases, int *lengths, int *total) {
+    int words[2 * MaxIoVecs];
+
+    if (count < 0 || count > MaxIoVecs ||
+        !kernel->currentThread->space->CopyIn(vaddr, (char *)words, count * 2 * sizeof(int))) {
+        return FALSE;
+    }
+    *total = 0;
+    for (int i = 0; i < count; i++) {
+        bases[i] = WordToHost(words[2 * i]);
+        lengths[i] = WordToHost(words[2 * i + 1]);
+        if (!BufferSizeOk(lengths[i]) || !BufferSizeOk(*total + lengths[i])) {
+            return FALSE;  // each is at most Size(), so the sum can't overflow
+        }
+        *total += lengths[i];
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DoWriteV, DoReadV
+//	Vectored I/O: gather the user's buffers into one kernel buffer
+//	and do a single write, or do a single read and scatter it.
+//----------------------------------------------------------------------
+
+static int
+DoWriteV(SyscallArg *args) {
+    AddrSpace *space = kernel->currentThread->space;
+    int bases[MaxIoVecs], lengths[MaxIoVecs];
+    int total, done = 0, result = EFAULT;
+    char *buffer;
+
+    if (!GetIoVecs(args[0].value, args[1].value, bases, lengths, &total)) {
+        return EINVAL;
+    }
+    buffer = new char[max(total, 1)];
+    for (int i = 0; i < args[1].value; i++) {
+        if (!space->CopyIn(bases[i], buffer + done, lengths[i])) {
+            break;
+        }
+        done += lengths[i];
+    }
+    if (done == total) {
+        result = SysWrite(buffer, total, args[2].value);
+    }
+    delete[] buffer;
+    return result;
+}
+
+static int
+DoReadV(SyscallArg *args) {
+    AddrSpace *space = kernel->currentThread->space;
+    int bases[MaxIoVecs], lengths[MaxIoVecs];
+    int total, done = 0, result;
+    char *buffer;
+
+    if (!GetIoVecs(args[0].value, args[1].value, bases, lengths, &total)) {
+        return EINVAL;
+    }
+    buffer = new char[max(total, 1)];
+    result = SysRead(buffer, total, args[2].value);
+    for (int i = 0; i < args[1].value && done < result; i++) {
+        int chunk = min(lengths[i], result - done);
+        if (!space->CopyOut(bases[i], buffer + done, chunk)) {
+            result = EFAULT;
+            break;
+        }
+        done += chunk;
+    }
+    delete[] buffer;
+    return result;
+}
+
+static int
+DoClose(SyscallArg *args) {
+    return SysClose(args[0].value);
+}
+
+static int
+DoSetRealTime(SyscallArg *args) {
+    return SysSetRealTime(args[0].value, args[1].value, args[2].value);
+}
+
+static int
+DoSleep(SyscallArg *args) {
+    SysSleep(args[0].value);
+    return 0;
+}
+
+static int
+DoFutexWait(SyscallArg *args) {
+    return SysFutexWait(args[0].value, args[1].value);
+}
+
+static int
+DoFutexWake(SyscallArg *args) {
+    return SysFutexWake(args[0].value, args[1].value);
+}
+
+static int
+DoSetAtomicRegion(SyscallArg *args) {
+    return SysSetAtomicRegion(args[0].value, args[1].value);
+}
+
+//----------------------------------------------------------------------
+// syscallTable
+//	The system calls we support.  Codes without an entry (such as
+//	SC_Remove, for now) are unexpected system calls.
+//----------------------------------------------------------------------
+
+static SyscallEntry syscallTable[] = {
+    {SC_Halt, "Halt", DoHalt, FALSE, 0, {IntArg}},
+    {SC_Exit, "Exit", DoExit, FALSE, 1, {IntArg}},
+    {SC_Exec, "Exec", DoExec, TRUE, 1, {StringArg}},
+    {SC_ExecV, "ExecV", DoExecV, TRUE, 2, {IntArg, IntArg}},
+    {SC_Join, "Join", DoJoin, TRUE, 1, {IntArg}},
+    {SC_ThreadFork, "ThreadFork", DoThreadFork, TRUE, 1, {IntArg}},
+    {SC_ThreadYield, "ThreadYield", DoThreadYield, FALSE, 0, {IntArg}},
+    {SC_ThreadJoin, "ThreadJoin", DoThreadJoin, TRUE, 1, {IntArg}},
+    {SC_ThreadExit, "ThreadExit", DoThreadExit, FALSE, 1, {IntArg}},
+    {SC_Create, "Create", DoCreate, TRUE, 1, {StringArg}},
+    {SC_Open, "Open", DoOpen, TRUE, 1, {StringArg}},
+    {SC_Read, "Read", DoRead, TRUE, 3, {IntArg, IntArg, IntArg}},
+    {SC_Write, "Write", DoWrite, TRUE, 3, {IntArg, IntArg, IntArg}},
+    {SC_Seek, "Seek", DoSeek, TRUE, 2, {IntArg, IntArg}},
+    {SC_Close, "Close", DoClose, TRUE, 1, {IntArg}},
+    {SC_PrintInt, "PrintInt", DoPrintInt, FALSE, 1, {IntArg}},
+    {SC_SetRealTime, "SetRealTime", DoSetRealTime, TRUE, 3, {IntArg, IntArg, IntArg}},
+    {SC_Sleep, "Sleep", DoSleep, FALSE, 1, {IntArg}},
+    {SC_FutexWait, "FutexWait", DoFutexWait, TRUE, 2, {IntArg, IntArg}},
+    {SC_FutexWake, "FutexWake", DoFutexWake, TRUE, 2, {IntArg, IntArg}},
+    {SC_SetAtomicRegion, "SetAtomicRegion", DoSetAtomicRegion, TRUE, 2, {IntArg, IntArg}},
+    {SC_ReadV, "ReadV", DoReadV, TRUE, 3, {IntArg, IntArg, IntArg}},
+    {SC_WriteV, "WriteV", DoWriteV, TRUE, 3, {IntArg, IntArg, IntArg}},
+    {SC_PRead, "PRead", DoPRead, TRUE, 4, {OutBufferArg, IntArg, IntArg, IntArg}},
+    {SC_PWrite, "PWrite", DoPWrite, TRUE, 4, {InBufferArg, IntArg, IntArg, IntArg}},
+    {SC_IoSetup, "IoSetup", DoIoSetup, TRUE, 1, {IntArg}},
+    {SC_IoEnter, "IoEnter", DoIoEnter, TRUE, 2, {IntArg, IntArg}},
+    {SC_Pipe, "Pipe", DoPipe, TRUE, 1, {IntArg}},
+    {SC_ShmCreate, "ShmCreate", DoShmCreate, TRUE, 1, {IntArg}},
+    {SC_ShmAttach, "ShmAttach", DoShmAttach, TRUE, 2, {IntArg, IntArg}},
+    {SC_ShmDetach, "ShmDetach", DoShmDetach, TRUE, 1, {IntArg}},
+    {SC_GetRUsage, "GetRUsage", DoGetRUsage, TRUE, 1, {IntArg}},
+    {SC_Add, "Add", DoAdd, TRUE, 2, {IntArg, IntArg}},
+    {SC_MSG, "MSG", DoMSG, FALSE, 1, {StringArg}},
+};
+
+static SyscallEntry *syscallIndex[NumSyscallCodes];  // by code, or NULL
+
+//----------------------------------------------------------------------
+// LookupSyscall
+//	Return the table entry for system call "code", or NULL.  The
+//	index is built the first time through.
+//----------------------------------------------------------------------
+
+static SyscallEntry *
+LookupSyscall(int code) {
+    static bool indexed = FALSE;
+
+    if (!indexed) {
+        for (unsigned int i = 0; i < sizeof(syscallTable) / sizeof(SyscallEntry); i++) {
+            ASSERT(syscallTable[i].code >= 0 && syscallTable[i].code < NumSyscallCodes);
+            syscallIndex[syscallTable[i].code] = &syscallTable[i];
+        }
+        indexed = TRUE;
+    }
+    if (code < 0 || code >= NumSyscallCodes) {
+        return NULL;
+    }
+    return syscallIndex[code];
+}
+
+//----------------------------------------------------------------------
+// GetArgs
+//	Fill in "args" from the argument registers, according to the
+//	types in "entry".  Strings and input buffers are copied into the
+//	kernel; output buffers are allocated.
+//
+//	Returns FALSE if an argument is a bad address (or size).  Any
+//	buffers allocated are freed by FreeArgs either way.
+//----------------------------------------------------------------------
+
+static bool
+GetArgs(SyscallEntry *entry, SyscallArg *args) {
+    AddrSpace *space = kernel->currentThread->space;
+    bool ok = TRUE;
+
+    for (int i = 0; i < entry->numArgs; i++) {
+        args[i].value = kernel->machine->ReadRegister(4 + i);
+    }
+    for (int i = 0; i < entry->numArgs; i++) {
+        int vaddr = args[i].value;
+        int size = (i + 1 < entry->numArgs) ? args[i + 1].value : 0;
+
+        switch (entry->argTypes[i]) {
+            case IntArg:
+                break;
+            case StringArg:
+                args[i].buffer = new char[MaxStringArg];
+                ok = ok && space->CopyInString(vaddr, args[i].buffer, MaxStringArg) >= 0;
+                break;
+            case InBufferArg:
+            case OutBufferArg:
+                if (!BufferSizeOk(size)) {
+                    args[i].buffer = NULL;
+                    ok = FALSE;
+                    break;
+                }
+                args[i].buffer = new char[max(size, 1)];
+                if (entry->argTypes[i] == InBufferArg) {
+                    ok = ok && space->CopyIn(vaddr, args[i].buffer, size);
+                }
+                break;
+        }
+    }
+    return ok;
+}
+
+//----------------------------------------------------------------------
+// PutArgs, FreeArgs
+//	After the call, copy output buffers back to the user ("result"
+//	bytes of them), and free the kernel's copies of the arguments.
+//	PutArgs returns the result of the call, or EFAULT if an output
+//	buffer is bad.
+//----------------------------------------------------------------------
+
+static int
+PutArgs(SyscallEntry *entry, SyscallArg *args, int result) {
+    AddrSpace *space = kernel->currentThread->space;
+
+    for (int i = 0; i < entry->numArgs; i++) {
+        if (entry->argTypes[i] == OutBufferArg && result > 0) {
+            int vaddr = kernel->machine->ReadRegister(4 + i);
+            if (!space->CopyOut(vaddr, args[i].buffer, result)) {
+                DEBUG(dbgSys, entry->name << ": bad output buffer " << vaddr);
+                return EFAULT;
+            }
+        }
+    }
+    return result;
+}
+
+static void
+FreeArgs(SyscallEntry *entry, SyscallArg *args) {
+    for (int i = 0; i < entry->numArgs; i++) {
+        if (entry->argTypes[i] != IntArg) {
+            delete[] args[i].buffer;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// TraceCall
+//	Log a system call, strace-style, with its arguments decoded
+//	according to their types: "pid: Name(args)", followed by
+//	" = result (ticks)" for calls that return a value.
+//----------------------------------------------------------------------
+
+static void
+TraceCall(SyscallEntry *entry, SyscallArg *args, bool ok) {
+    Process *process = kernel->currentThread->process;
+
+    cerr << "[" << (process != NULL ? process->getID() : 0) << "] "
+         << entry->name << "(";
+    for (int i = 0; i < entry->numArgs; i++) {
+        if (i > 0) {
+            cerr << ", ";
+        }
+        if (entry->argTypes[i] == IntArg || !ok) {
+            cerr << kernel->machine->ReadRegister(4 + i);
+        } else if (entry->argTypes[i] == StringArg) {
+            cerr << "\"" << args[i].buffer << "\"";
+        } else {
+            cerr << "0x" << hex << kernel->machine->ReadRegister(4 + i) << dec;
+        }
+    }
+    cerr << ")";
+}
+
+//----------------------------------------------------------------------
+// AdvancePC
+//	Move the program counter past the syscall instruction, or the
+//	user program would make the same system call forever.
+//----------------------------------------------------------------------
+
+static void
+AdvancePC() {
+    Machine *machine = kernel->machine;
+
+    machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+    machine->WriteRegister(PCReg, machine->ReadRegister(PCReg) + 4);
+    machine->WriteRegister(NextPCReg, machine->ReadRegister(PCReg) + 4);
+}
+
+//----------------------------------------------------------------------
+// DoSyscall
+//	The common path of every system call, described by "entry".
+//	The call is accounted for in kernel->syscallStats, and logged
+//	if tracing; calls without a result are logged before they run,
+//	since some of them (Exit, Halt) never return.
+//----------------------------------------------------------------------
+
+static void
+DoSyscall(SyscallEntry *entry) {
+    SyscallStats *syscallStats = kernel->syscallStats;
+    int startTick = kernel->stats->totalTicks;
+    double startUsecs = 0;
+    SyscallArg args[MaxSyscallArgs];
+    int result = EFAULT;
+    bool ok;
+
+    if (syscallStats->IsTimingHost()) {
+        startUsecs = HostMicroseconds();
+    }
+    DEBUG(dbgSys, "System call " << entry->name);
+    syscallStats->Enter(entry->code, entry->name);
+    ok = GetArgs(entry, args);
+    if (syscallStats->IsTracing() && !entry->hasResult) {
+        TraceCall(entry, args, ok);
+        cerr << "\n";
+    }
+    if (ok) {
+        result = (*entry->handler)(args);
+        result = PutArgs(entry, args, result);
+    } else {
+        DEBUG(dbgSys, entry->name << ": bad address argument");
+    }
+    if (syscallStats->IsTracing() && entry->hasResult) {
+        TraceCall(entry, args, ok);
+        cerr << " = " << result << " (" << kernel->stats->totalTicks - startTick
+             << " ticks)\n";
+    }
+    FreeArgs(entry, args);
+    syscallStats->Leave(entry->code, startTick, startUsecs);
+    DEBUG(dbgSys, entry->name << " returning " << result);
+
+    if (entry->hasResult) {
+        kernel->machine->WriteRegister(2, result);
+    }
+    AdvancePC();
+    kernel->currentThread->CheckExiting();  // Exit by another thread?
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -48,168 +733,27 @@
 //	is in machine.h.
 //----------------------------------------------------------------------
 void ExceptionHandler(ExceptionType which) {
-    char ch;
-    int val;
     int type = kernel->machine->ReadRegister(2);
-    int status, exit, threadID, programID, fileID, numChar, endPos;
+    SyscallEntry *entry;
+
     DEBUG(dbgSys, "Received Exception " << which << " type: " << type << "\n");
     DEBUG(dbgTraCode, "In ExceptionHandler(), Received Exception " << which << " type: " << type << ", " << kernel->stats->totalTicks);
     switch (which) {
         case SyscallException:
-            switch (type) {
-                case SC_Halt:
-                    DEBUG(dbgSys, "Shutdown, initiated by user program.\n");
-                    SysHalt();
-                    cout << "in exception\n";
-                    ASSERTNOTREACHED();
-                    break;
-                case SC_PrintInt:
-                    DEBUG(dbgSys, "Print Int\n");
-                    val = kernel->machine->ReadRegister(4);
-                    DEBUG(dbgTraCode, "In ExceptionHandler(), into SysPrintInt, " << kernel->stats->totalTicks);
-                    SysPrintInt(val);
-                    DEBUG(dbgTraCode, "In ExceptionHandler(), return from SysPrintInt, " << kernel->stats->totalTicks);
-                    // Set Program Counter
-                    kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-                    kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                    kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                    return;
-                    ASSERTNOTREACHED();
-                    break;
-                case SC_MSG:
-                    DEBUG(dbgSys, "Message received.\n");
-                    val = kernel->machine->ReadRegister(4);
-                    {
-                        char *msg = &(kernel->machine->mainMemory[val]);
-                        cout << msg << endl;
-                    }
-                    SysHalt();
-                    ASSERTNOTREACHED();
-                    break;
-                case SC_Create:
-                    val = kernel->machine->ReadRegister(4);
-                    {
-                        char *filename = &(kernel->machine->mainMemory[val]);
-                        // cout << filename << endl;
-                        status = SysCreate(filename);
-                        kernel->machine->WriteRegister(2, (int)status);
-                    }
-                    kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-                    kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                    kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                    return;
-                    ASSERTNOTREACHED();
-                    break;
-                case SC_Open:
-                    val = kernel->machine->ReadRegister(4);
-                    {
-                        char *filename = &(kernel->machine->mainMemory[val]);
-                        // cout << filename << endl;
-                        fileID = SysOpen(filename);
-                        kernel->machine->WriteRegister(2, fileID);
-                    }
-                    DEBUG(dbgSys, "Successfully open file with id = " << fileID << "\n");
-                    {
-                        /* set program counter */
-                        kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-                        kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                        kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                    }
-                    return;
-                    ASSERTNOTREACHED();
-                    break;
-                case SC_Write:
-                    val = kernel->machine->ReadRegister(4);
-                    numChar = kernel->machine->ReadRegister(5);
-                    fileID = kernel->machine->ReadRegister(6);
-                    {
-                        char *filename = &(kernel->machine->mainMemory[val]);
-                        // cout << filename << endl;
-                        status = SysWrite(filename, numChar, fileID);
-                        kernel->machine->WriteRegister(2, status);
-                    }
-                    DEBUG(dbgSys, "Successfully write file with id = " << fileID << "\n");
-                    {
-                        /* set program counter */
-                        kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-                        kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                        kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                    }
-                    return;
-                    ASSERTNOTREACHED();
-                    break;
-                case SC_Read:
-                    val = kernel->machine->ReadRegister(4);
-                    numChar = kernel->machine->ReadRegister(5);
-                    fileID = kernel->machine->ReadRegister(6);
-                    {
-                        char *filename = &(kernel->machine->mainMemory[val]);
-                        // cout << filename << endl;
-                        status = SysRead(filename, numChar, fileID);
-                        kernel->machine->WriteRegister(2, status);
-                    }
-                    DEBUG(dbgSys, "Successfully read file with id = " << fileID << "\n");
-                    {
-                        /* set program counter */
-                        kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-                        kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                        kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                    }
-                    return;
-                    ASSERTNOTREACHED();
-                    break;
-                case SC_Close:
-                    fileID = kernel->machine->ReadRegister(4);
-                    DEBUG(dbgSys, "Tried close file " << fileID);
-                    {
-                        // cout << filename << endl;
-                        status = SysClose(fileID);
-                        kernel->machine->WriteRegister(2, status);
-                    }
-                    DEBUG(dbgSys, "file with id = " << fileID << " closed with status " << status << ". \n");
-                    {
-                        /* set program counter */
-                        kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-                        kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                        kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                    }
-                    return;
-                    ASSERTNOTREACHED();
-                    break;
-                case SC_Add:
-                    DEBUG(dbgSys, "Add " << kernel->machine->ReadRegister(4) << " + " << kernel->machine->ReadRegister(5) << "\n");
-                    /* Process SysAdd Systemcall*/
-                    int result;
-                    result = SysAdd(/* int op1 */ (int)kernel->machine->ReadRegister(4),
-                                    /* int op2 */ (int)kernel->machine->ReadRegister(5));
-                    DEBUG(dbgSys, "Add returning with " << result << "\n");
-                    /* Prepare Result */
-                    kernel->machine->WriteRegister(2, (int)result);
-                    /* Modify return point */
-                    {
-                        /* set previous programm counter (debugging only)*/
-                        kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-
-                        /* set programm counter to next instruction (all Instructions are 4 byte wide)*/
-                        kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-
-                        /* set next programm counter for brach execution */
-                        kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-                    }
-                    cout << "result is " << result << "\n";
-                    return;
-                    ASSERTNOTREACHED();
-                    break;
-                case SC_Exit:
-                    DEBUG(dbgAddr, "Program exit\n");
-                    val = kernel->machine->ReadRegister(4);
-                    cout << "return value:" << val << endl;
-                    kernel->currentThread->Finish();
-                    break;
-                default:
-                    cerr << "Unexpected system call " << type << "\n";
-                    break;
+            entry = LookupSyscall(type);
+            if (entry != NULL) {
+                DoSyscall(entry);
+                return;
+            }
+            cerr << "Unexpected system call " << type << "\n";
+            break;
+        case ReadOnlyException:  // copy-on-write page written to?
+            if (kernel->currentThread->space->BreakCopyOnWrite(
+                    (unsigned int)kernel->machine->ReadRegister(BadVAddrReg) / PageSize)) {
+                return;  // the write is retried
             }
+            cerr << "Write to read-only page, or out of memory copying it\n";
+            ExitProcess(-1);
             break;
         default:
             cerr << "Unexpected user mode exception " << (int)which << "\n";
@@ -0,0 +1,223 @@
+// fdtable.cc
+//	Routines to manage the descriptor table of a process, and the
+//	open files the descriptors refer to.  See fdtable.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "fdtable.h"
+
+#include <strings.h>
+
+#include "copyright.h"
+#include "debug.h"
+#include "filesys.h"
+#include "pipe.h"
+#include "syscall.h"
+
+//----------------------------------------------------------------------
+// FileHandle::FileHandle
+//	Wrap an open file, or one end of a pipe.  The caller has the
+//	only reference.
+//----------------------------------------------------------------------
+
+FileHandle::FileHandle(OpenFile *openFile) {
+    file = openFile;
+    pipe = NULL;
+    writeEnd = FALSE;
+    refs = 1;
+}
+
+FileHandle::FileHandle(PipeBuffer *pipeBuffer, bool isWriteEnd) {
+    file = NULL;
+    pipe = pipeBuffer;
+    writeEnd = isWriteEnd;
+    refs = 1;
+}
+
+//----------------------------------------------------------------------
+// FileHandle::~FileHandle
+//	Close the file, or the pipe end.  The pipe itself goes once
+//	both of its ends are closed.
+//----------------------------------------------------------------------
+
+FileHandle::~FileHandle() {
+    delete file;
+    if (pipe != NULL && pipe->CloseEnd(writeEnd)) {
+        delete pipe;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHandle::Hold, FileHandle::Release
+//	Add and drop a reference.  Closing a pipe end may have to wait
+//	for the pipe's lock, so the last Release must be made by a
+//	thread that can block.
+//----------------------------------------------------------------------
+
+void FileHandle::Hold() {
+    refs++;
+}
+
+void FileHandle::Release() {
+    ASSERT(refs > 0);
+    if (--refs == 0) {
+        delete this;
+    }
+}
+
+//----------------------------------------------------------------------
+// FdTable::FdTable
+//	Initialize a table of InitialFdSlots descriptors, with only the
+//	console's taken.
+//----------------------------------------------------------------------
+
+FdTable::FdTable() {
+    handles = NULL;
+    inUse = NULL;
+    size = 0;
+    Grow(InitialFdSlots);
+    for (int fd = 0; fd < NumReservedFds; fd++) {
+        inUse[fd / BitsPerFdWord] |= 1 << (fd % BitsPerFdWord);
+    }
+    firstFreeWord = 0;
+}
+
+//----------------------------------------------------------------------
+// FdTable::~FdTable
+//	Close everything still open, and de-allocate the table.
+//----------------------------------------------------------------------
+
+FdTable::~FdTable() {
+    CloseAll();
+    delete[] handles;
+    delete[] inUse;
+}
+
+//----------------------------------------------------------------------
+// FdTable::Grow
+//	Make the table "newSize" descriptors long; the new ones are free.
+//----------------------------------------------------------------------
+
+void FdTable::Grow(int newSize) {
+    FileHandle **newHandles = new FileHandle *[newSize];
+    unsigned int *newInUse = new unsigned int[newSize / BitsPerFdWord];
+
+    ASSERT(newSize > size && newSize % BitsPerFdWord == 0);
+    for (int fd = 0; fd < newSize; fd++) {
+        newHandles[fd] = (fd < size) ? handles[fd] : NULL;
+    }
+    for (int w = 0; w < newSize / BitsPerFdWord; w++) {
+        newInUse[w] = (w < size / BitsPerFdWord) ? inUse[w] : 0;
+    }
+    delete[] handles;
+    delete[] inUse;
+    handles = newHandles;
+    inUse = newInUse;
+    size = newSize;
+}
+
+//----------------------------------------------------------------------
+// FdTable::Install
+//	Give "handle" the lowest free descriptor, growing the table if
+//	it is full.  The table takes over the caller's reference.
+//
+//	Returns the descriptor, or EMFILE if MaxOpenFiles are open (the
+//	caller still owns "handle" then).
+//----------------------------------------------------------------------
+
+int FdTable::Install(FileHandle *handle) {
+    int numWords = size / BitsPerFdWord;
+    int w = firstFreeWord;
+
+    while (w < numWords && inUse[w] == ~0U) {
+        w++;
+    }
+    if (w == numWords) {
+        if (size == MaxOpenFiles) {
+            firstFreeWord = numWords;
+            return EMFILE;
+        }
+        Grow(min(size * 2, MaxOpenFiles));
+    }
+    int bit = ffs(~inUse[w]) - 1;
+    int fd = w * BitsPerFdWord + bit;
+
+    inUse[w] |= 1U << bit;
+    firstFreeWord = w;
+    handles[fd] = handle;
+    DEBUG(dbgSys, "Descriptor " << fd << " opened");
+    return fd;
+}
+
+//----------------------------------------------------------------------
+// FdTable::Lookup
+//	Return the handle "fd" refers to, or NULL if "fd" is not open.
+//	The caller should Hold() it if it may block while using it.
+//----------------------------------------------------------------------
+
+FileHandle *
+FdTable::Lookup(int fd) {
+    if (fd < 0 || fd >= size) {
+        return NULL;
+    }
+    return handles[fd];
+}
+
+//----------------------------------------------------------------------
+// FdTable::Close
+//	Free descriptor "fd", dropping its reference to the handle.
+//	Returns 1, or -1 if "fd" is not open.
+//----------------------------------------------------------------------
+
+int FdTable::Close(int fd) {
+    FileHandle *handle = Lookup(fd);
+
+    if (handle == NULL) {
+        return -1;
+    }
+    handles[fd] = NULL;
+    inUse[fd / BitsPerFdWord] &= ~(1U << (fd % BitsPerFdWord));
+    firstFreeWord = min(firstFreeWord, fd / BitsPerFdWord);
+    handle->Release();
+    return 1;
+}
+
+//----------------------------------------------------------------------
+// FdTable::CloseAll
+//	Close every descriptor still open; the process is done with
+//	them.
+//----------------------------------------------------------------------
+
+void FdTable::CloseAll() {
+    for (int fd = NumReservedFds; fd < size; fd++) {
+        if (handles[fd] != NULL) {
+            DEBUG(dbgSys, "Closing descriptor " << fd << " left open");
+            Close(fd);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// FdTable::Inherit
+//	A new process, with nothing open yet, starts with the same
+//	descriptors as "parent", referring to the same handles.
+//----------------------------------------------------------------------
+
+void FdTable::Inherit(FdTable *parent) {
+    if (parent->size > size) {
+        Grow(parent->size);
+    }
+    for (int fd = NumReservedFds; fd < parent->size; fd++) {
+        ASSERT(handles[fd] == NULL);
+        handles[fd] = parent->handles[fd];
+        if (handles[fd] != NULL) {
+            handles[fd]->Hold();
+        }
+    }
+    for (int w = 0; w < parent->size / BitsPerFdWord; w++) {
+        inUse[w] = parent->inUse[w];
+    }
+    firstFreeWord = parent->firstFreeWord;
+}
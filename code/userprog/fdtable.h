@@ -0,0 +1,88 @@
+// fdtable.h
+//	Data structures for the files a process has open.
+//
+//	A user program names the files it has open by small integers,
+//	file descriptors (OpenFileIds), private to the process.  Each
+//	descriptor refers to a FileHandle: an open file, or one end of a
+//	pipe.  Handles are reference counted, so that several descriptors
+//	can share one, along with its seek position: a process started by
+//	Exec or ExecV inherits all of its parent's descriptors.  A handle
+//	is closed once its last reference goes.  A system call or I/O
+//	request using a handle holds a reference of its own, so a file
+//	closed by another thread meanwhile stays open until it is done.
+//
+//	Open (and Pipe) always hand out the lowest free descriptor.  The
+//	table keeps a bitmap of descriptors in use, so that the lowest
+//	free one is found a word (32 descriptors) at a time, starting
+//	from the first word with a free bit.  The table starts small and
+//	doubles in size when it is full, up to MaxOpenFiles.
+//
+//	Descriptors 0 and 1 are reserved for the console (SysConsoleInput
+//	and SysConsoleOutput in syscall.h), and are never handed out;
+//	Read and Write go straight to the console for them.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FDTABLE_H
+#define FDTABLE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+class OpenFile;
+class PipeBuffer;
+
+const int BitsPerFdWord = 32;
+const int InitialFdSlots = 32;  // descriptors in a new table
+const int MaxOpenFiles = 1024;  // descriptors a process can have
+const int NumReservedFds = 2;   // 0 and 1, for the console
+
+// The following class defines an open file, or pipe end, shared by
+// all the descriptors referring to it.
+
+class FileHandle {
+   public:
+    FileHandle(OpenFile *openFile);  // an open file, one reference
+    FileHandle(PipeBuffer *pipeBuffer, bool isWriteEnd);
+    // one end of a pipe, one reference
+
+    void Hold();     // one more reference
+    void Release();  // one less: the last one closes it
+
+    OpenFile *file;    // NULL for a pipe end
+    PipeBuffer *pipe;  // NULL for a file
+    bool writeEnd;     // which end of "pipe"
+
+   private:
+    ~FileHandle();  // close the file or pipe end; see Release()
+    int refs;       // descriptors and requests using it
+};
+
+// The following class defines the descriptor table of a process.
+
+class FdTable {
+   public:
+    FdTable();   // nothing open but the console
+    ~FdTable();  // close whatever is still open
+
+    int Install(FileHandle *handle);  // the lowest free descriptor now
+                                      // refers to "handle" (taking over
+                                      // the caller's reference); the
+                                      // descriptor, or EMFILE if none
+    FileHandle *Lookup(int fd);  // NULL if "fd" is not open
+    int Close(int fd);           // 1, or -1 if "fd" is not open
+    void CloseAll();             // close every descriptor
+    void Inherit(FdTable *parent);  // share the parent's open files
+
+   private:
+    FileHandle **handles;  // by descriptor; NULL if not open
+    unsigned int *inUse;   // bitmap of descriptors taken
+    int size;              // descriptors, a multiple of BitsPerFdWord
+    int firstFreeWord;     // no descriptor free below this word
+
+    void Grow(int newSize);  // make room for "newSize" descriptors
+};
+
+#endif  // FDTABLE_H
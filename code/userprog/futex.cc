@@ -0,0 +1,189 @@
+// futex.cc
+//	Routines to let user threads wait on and wake up each other
+//	through words in their memory.  See futex.h.
+//
+//	Interrupts are disabled while checking the word and queueing the
+//	thread, so a wake-up cannot slip in between; the user-level lock
+//	code relies on that.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "futex.h"
+
+#include "addrspace.h"
+#include "copyright.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// FutexKey, FutexHash
+//	Functions the hash table uses to get the key of a queue, and
+//	to hash it.  Futex words are aligned, so drop the low bits.
+//----------------------------------------------------------------------
+
+static int
+FutexKey(FutexQueue *queue) {
+    return queue->key;
+}
+
+static unsigned int
+FutexHash(int physAddr) {
+    return (unsigned int)physAddr >> 2;
+}
+
+//----------------------------------------------------------------------
+// FutexQueue::FutexQueue, FutexQueue::~FutexQueue
+//	Create and delete the wait queue of one futex.
+//----------------------------------------------------------------------
+
+FutexQueue::FutexQueue(int physAddr) {
+    key = physAddr;
+    waiters = new List<Thread *>;
+}
+
+FutexQueue::~FutexQueue() {
+    ASSERT(waiters->IsEmpty());
+    delete waiters;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::FutexTable, FutexTable::~FutexTable
+//	Initialize and de-allocate the futex table.
+//----------------------------------------------------------------------
+
+FutexTable::FutexTable() {
+    queues = new HashTable<int, FutexQueue *>(FutexKey, FutexHash);
+}
+
+FutexTable::~FutexTable() {
+    delete queues;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::PhysicalAddress
+//	Translate the user address of a futex word.  Returns FALSE if
+//	it is not an aligned, writable word of the address space.
+//----------------------------------------------------------------------
+
+bool FutexTable::PhysicalAddress(AddrSpace *space, int virtAddr,
+                                 int *physAddr) {
+    unsigned int addr;
+
+    if (space == NULL || (virtAddr & 0x3) != 0 ||
+        space->Translate(virtAddr, &addr, 1) != NoException) {
+        return FALSE;
+    }
+    *physAddr = addr;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wait
+//	Put the current thread to sleep on the futex at "virtAddr",
+//	provided the word there still holds "expected".  If it doesn't,
+//	the lock has changed hands since the caller looked at it, and
+//	it should try again rather than sleep.
+//
+//	Returns 0 after being woken up by Wake(), -1 if the value was
+//	different or the address is bad, or if the caller's process is
+//	exiting.
+//----------------------------------------------------------------------
+
+int FutexTable::Wait(AddrSpace *space, int virtAddr, int expected) {
+    Thread *currentThread = kernel->currentThread;
+    FutexQueue *queue;
+    int physAddr;
+    int result = -1;
+
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    if (PhysicalAddress(space, virtAddr, &physAddr) &&
+        (int)WordToHost(*(unsigned int *)&kernel->machine->mainMemory[physAddr]) == expected &&
+        !currentThread->IsExiting()) {
+        FutexWaiter waiter(this, physAddr, currentThread);
+
+        if (!queues->Find(physAddr, &queue)) {
+            queue = new FutexQueue(physAddr);
+            queues->Insert(queue);
+        }
+        queue->waiters->Append(currentThread);
+        DEBUG(dbgSynch, "Thread " << currentThread->getName()
+                                  << " waits on futex " << virtAddr);
+        currentThread->SetCancelWait(&waiter);
+        currentThread->Sleep(FALSE);  // until Wake() or Cancel() takes
+                                      // us off the queue
+        currentThread->SetCancelWait(NULL);
+        result = currentThread->IsExiting() ? -1 : 0;
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+    return result;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wake
+//	Wake up at most "count" threads waiting on the futex at
+//	"virtAddr", oldest first.  The queue is deleted once empty.
+//
+//	Returns the number of threads woken up, or -1 if the address
+//	is bad.
+//----------------------------------------------------------------------
+
+int FutexTable::Wake(AddrSpace *space, int virtAddr, int count) {
+    FutexQueue *queue;
+    int physAddr;
+    int woken = 0;
+
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    if (!PhysicalAddress(space, virtAddr, &physAddr)) {
+        woken = -1;
+    } else if (queues->Find(physAddr, &queue)) {
+        while (woken < count && !queue->waiters->IsEmpty()) {
+            kernel->scheduler->ReadyToRun(queue->waiters->RemoveFront());
+            woken++;
+        }
+        if (queue->waiters->IsEmpty()) {
+            queues->Remove(physAddr);
+            delete queue;
+        }
+    }
+    DEBUG(dbgSynch, "Woke " << woken << " threads on futex " << virtAddr);
+    (void)kernel->interrupt->SetLevel(oldLevel);
+    return woken;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Cancel
+//	Thread "t", which was waiting on the futex at physical address
+//	"physAddr", has to give up: its process is exiting.  Take it off
+//	the queue and wake it up, unless Wake() already has.
+//----------------------------------------------------------------------
+
+void FutexTable::Cancel(int physAddr, Thread *t) {
+    FutexQueue *queue;
+
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    if (queues->Find(physAddr, &queue) && queue->waiters->IsInList(t)) {
+        queue->waiters->Remove(t);
+        kernel->scheduler->ReadyToRun(t);
+        if (queue->waiters->IsEmpty()) {
+            queues->Remove(physAddr);
+            delete queue;
+        }
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// FutexWaiter::FutexWaiter, FutexWaiter::CallBack
+//	Remember where thread "t" waits, so that Exit can wake it up.
+//----------------------------------------------------------------------
+
+FutexWaiter::FutexWaiter(FutexTable *futexTable, int physAddr, Thread *t) {
+    table = futexTable;
+    key = physAddr;
+    thread = t;
+}
+
+void FutexWaiter::CallBack() {
+    table->Cancel(key, thread);
+}
@@ -0,0 +1,82 @@
+// futex.h
+//	Data structures for "fast user-space mutexes" (futexes).
+//
+//	User programs keep their locks in their own memory, and update
+//	them without trapping to the kernel.  Only when a thread has to
+//	wait, or has to wake up waiters, does it call FutexWait or
+//	FutexWake on the address of the lock word.
+//
+//	Wait queues are kept in a hash table keyed by the *physical*
+//	address of the word, so threads sharing memory find the same
+//	queue whatever virtual address they use for it.  A queue only
+//	exists while someone is waiting on it.
+//
+//	A thread whose process exits while it waits is taken off the
+//	queue and woken up, so that it can finish.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "callback.h"
+#include "copyright.h"
+#include "hash.h"
+#include "list.h"
+
+class Thread;
+class AddrSpace;
+class FutexTable;
+
+// The following class defines the threads waiting on one futex.
+
+class FutexQueue {
+   public:
+    FutexQueue(int physAddr);  // an empty queue for this address
+    ~FutexQueue();
+
+    int key;                  // physical address of the futex word
+    List<Thread *> *waiters;  // in arrival order
+};
+
+// The following class defines a thread waiting on a futex, as Exit
+// sees it.
+
+class FutexWaiter : public CallBackObj {
+   public:
+    FutexWaiter(FutexTable *futexTable, int physAddr, Thread *t);
+
+    void CallBack();  // its process is exiting: wake it up
+
+   private:
+    FutexTable *table;
+    int key;         // physical address of the futex word
+    Thread *thread;
+};
+
+// The following class defines the kernel's table of futex queues.
+
+class FutexTable {
+   public:
+    FutexTable();   // initialize an empty table
+    ~FutexTable();  // de-allocate the table
+
+    int Wait(AddrSpace *space, int virtAddr, int expected);
+    // if the word at virtAddr still holds
+    // "expected", sleep until woken up;
+    // 0 if woken, -1 otherwise
+    int Wake(AddrSpace *space, int virtAddr, int count);
+    // wake up to "count" waiters; returns
+    // how many were woken, -1 if bad address
+    void Cancel(int physAddr, Thread *t);  // wake up "t", if it is
+                                          // still waiting there
+
+   private:
+    HashTable<int, FutexQueue *> *queues;  // by physical address
+
+    bool PhysicalAddress(AddrSpace *space, int virtAddr, int *physAddr);
+};
+
+#endif  // FUTEX_H
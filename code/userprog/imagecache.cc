@@ -0,0 +1,242 @@
+// imagecache.cc
+//	Routines to read user programs once and keep them in memory.
+//	See imagecache.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "imagecache.h"
+
+#include "addrspace.h"
+#include "copyright.h"
+#include "main.h"
+#include "syscall.h"
+
+//----------------------------------------------------------------------
+// SwapHeader
+// 	Do little endian to big endian conversion on the bytes in the
+//	object file header, in case the file was generated on a little
+//	endian machine, and we're now running on a big endian machine.
+//----------------------------------------------------------------------
+
+static void
+SwapHeader(NoffHeader *noffH) {
+    noffH->noffMagic = WordToHost(noffH->noffMagic);
+    noffH->code.size = WordToHost(noffH->code.size);
+    noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
+    noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
+#ifdef RDATA
+    noffH->readonlyData.size = WordToHost(noffH->readonlyData.size);
+    noffH->readonlyData.virtualAddr =
+        WordToHost(noffH->readonlyData.virtualAddr);
+    noffH->readonlyData.inFileAddr =
+        WordToHost(noffH->readonlyData.inFileAddr);
+#endif
+    noffH->initData.size = WordToHost(noffH->initData.size);
+    noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
+    noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
+    noffH->uninitData.size = WordToHost(noffH->uninitData.size);
+    noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
+    noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
+
+#ifdef RDATA
+    DEBUG(dbgAddr, "code = " << noffH->code.size << " readonly = " << noffH->readonlyData.size << " init = " << noffH->initData.size << " uninit = " << noffH->uninitData.size << "\n");
+#endif
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::ProgramImage, ProgramImage::~ProgramImage
+//	Create and de-allocate the cache entry of a program.
+//----------------------------------------------------------------------
+
+ProgramImage::ProgramImage(char *fileName) {
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    contents = NULL;
+    numPages = 0;
+    textFrames = NULL;
+    users = 0;
+}
+
+ProgramImage::~ProgramImage() {
+    delete[] name;
+    delete[] contents;
+    delete[] textFrames;
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::Read
+//	Read the whole NOFF file in, and work out the size of an address
+//	space running it.  Returns 0, ENOENT if the file can't be opened,
+//	or ENOEXEC if it is not a NOFF file.
+//----------------------------------------------------------------------
+
+int ProgramImage::Read() {
+    OpenFile *executable = kernel->fileSystem->Open(name);
+    unsigned int size;
+    int length;
+
+    if (executable == NULL) {
+        return ENOENT;
+    }
+    length = executable->Length();
+    if (length < (int)sizeof(header)) {
+        delete executable;
+        return ENOEXEC;
+    }
+    contents = new char[length];
+    executable->ReadAt(contents, length, 0);
+    delete executable;
+
+    bcopy(contents, (char *)&header, sizeof(header));
+    if ((header.noffMagic != NOFFMAGIC) &&
+        (WordToHost(header.noffMagic) == NOFFMAGIC))
+        SwapHeader(&header);
+    if (header.noffMagic != NOFFMAGIC) {
+        DEBUG(dbgAddr, "Not a NOFF file: " << name);
+        return ENOEXEC;
+    }
+
+#ifdef RDATA
+    // how big is address space?
+    size = header.code.size + header.readonlyData.size + header.initData.size +
+           header.uninitData.size + UserStackSize;
+    // we need to increase the size
+    // to leave room for the stack
+#else
+    // how big is address space?
+    size = header.code.size + header.initData.size + header.uninitData.size + UserStackSize;  // we need to increase the size
+                                                                                              // to leave room for the stack
+#endif
+    numPages = divRoundUp(size, PageSize);
+    textFrames = new int[numPages];
+    for (int i = 0; i < numPages; i++) {
+        textFrames[i] = -1;
+    }
+    DEBUG(dbgAddr, "Cached program " << name << ": " << length << " bytes");
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::IsTextPage
+//	Is virtual page "vpn" entirely inside the code segment?  Only
+//	such pages are shared; a page holding the end of the code and
+//	the start of the data is not.
+//----------------------------------------------------------------------
+
+bool ProgramImage::IsTextPage(int vpn) {
+    return header.code.size > 0 &&
+           vpn * PageSize >= header.code.virtualAddr &&
+           (vpn + 1) * PageSize <= header.code.virtualAddr + header.code.size;
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::NumSharedPages
+//	How many pages a new instance gets from the running ones, rather
+//	than from the frame allocator.
+//----------------------------------------------------------------------
+
+int ProgramImage::NumSharedPages() {
+    int count = 0;
+
+    for (int i = 0; i < numPages; i++) {
+        if (textFrames[i] >= 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::Release
+//	An instance of the program is going away.  Once none is left,
+//	their code frames are being freed, so forget them.
+//----------------------------------------------------------------------
+
+void ProgramImage::Release() {
+    ASSERT(users > 0);
+    if (--users == 0) {
+        for (int i = 0; i < numPages; i++) {
+            textFrames[i] = -1;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// ImageCache::ImageCache, ImageCache::~ImageCache
+//	Initialize and de-allocate the cache.
+//----------------------------------------------------------------------
+
+ImageCache::ImageCache() {
+    images = new List<ProgramImage *>;
+}
+
+ImageCache::~ImageCache() {
+    while (!images->IsEmpty()) {
+        delete images->RemoveFront();
+    }
+    delete images;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Get
+//	Find the program in file "fileName", reading it in the first
+//	time (or the first time since it was dropped from the cache).
+//	It becomes the most recently loaded.
+//
+//	Returns NULL if the program can't be read, with "*error" set to
+//	ENOENT if there is no such file, or ENOEXEC if it is not a NOFF
+//	file.
+//----------------------------------------------------------------------
+
+ProgramImage *
+ImageCache::Get(char *fileName, int *error) {
+    ListIterator<ProgramImage *> iter(images);
+    ProgramImage *image = NULL;
+
+    for (; !iter.IsDone(); iter.Next()) {
+        if (strcmp(iter.Item()->name, fileName) == 0) {
+            image = iter.Item();
+            break;
+        }
+    }
+    if (image != NULL) {
+        images->Remove(image);
+    } else {
+        image = new ProgramImage(fileName);
+        *error = image->Read();
+        if (*error < 0) {
+            delete image;
+            return NULL;
+        }
+        Evict();
+    }
+    images->Append(image);
+    return image;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Evict
+//	Make room for one more program, if MaxCachedImages are cached,
+//	by dropping the least recently loaded one not running.  If they
+//	are all running, the cache grows past MaxCachedImages for now.
+//----------------------------------------------------------------------
+
+void ImageCache::Evict() {
+    ListIterator<ProgramImage *> iter(images);
+
+    if (images->NumInList() < MaxCachedImages) {
+        return;
+    }
+    for (; !iter.IsDone(); iter.Next()) {
+        ProgramImage *image = iter.Item();
+
+        if (image->users == 0) {
+            DEBUG(dbgAddr, "Dropping cached program " << image->name);
+            images->Remove(image);
+            delete image;
+            return;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+// imagecache.h
+//	Data structures to keep user programs in memory once they have
+//	been run, so that starting them again is cheap.
+//
+//	The first time a program is loaded, its NOFF file is read in
+//	whole, and its header decoded.  After that, loading it again
+//	only copies from memory.  Besides, running instances of the same
+//	program share the frames of their code pages: pages lying
+//	entirely in the code segment are mapped read-only into every
+//	instance, rather than loaded into fresh frames.  The cache
+//	remembers those frames only while some instance is running;
+//	they are freed like any other when the last one goes away.
+//
+//	At most MaxCachedImages programs are kept.  When the cache is
+//	full, the least recently loaded program not running is dropped
+//	to make room; programs running are always kept, since their
+//	instances refer to them.
+//
+//	Programs are assumed not to change while Nachos is running.
+//	Files which are not NOFF programs are never cached.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include "copyright.h"
+#include "list.h"
+#include "noff.h"
+
+const int MaxCachedImages = 16;  // programs kept, if not running
+
+// The following class defines a program, as read from its file.
+
+class ProgramImage {
+   public:
+    ProgramImage(char *fileName);  // just the name; Read() does the work
+    ~ProgramImage();
+
+    int Read();  // read in and check the file; 0, or
+                 // ENOENT or ENOEXEC
+
+    char *name;
+    NoffHeader header;  // in host byte order
+    char *contents;     // the whole file
+    int numPages;       // pages in an address space running it,
+                        // with the stack
+    int *textFrames;    // frame shared by the instances running, for
+                        // each page of code; -1 if none (yet)
+    int users;          // address spaces running it
+
+    bool IsTextPage(int vpn);  // is the page all code?
+    int NumSharedPages();      // pages found in textFrames
+    void Release();            // one instance less
+};
+
+// The following class defines the cache of programs.
+
+class ImageCache {
+   public:
+    ImageCache();   // an empty cache
+    ~ImageCache();  // de-allocate all cached programs
+
+    ProgramImage *Get(char *fileName, int *error);
+    // the program, reading it in if needed;
+    // NULL, with the error, if it can't
+   private:
+    List<ProgramImage *> *images;  // least recently loaded first
+
+    void Evict();  // drop a program not running, if too many
+};
+
+#endif  // IMAGECACHE_H
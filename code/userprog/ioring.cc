@@ -0,0 +1,307 @@
+// ioring.cc
+//	Routines to carry out asynchronous I/O requests queued by user
+//	programs on rings in their own memory.  See ioring.h.
+//
+//	The completion ring has as many slots as the submission ring.
+//	To be sure a result always has somewhere to go, a request is only
+//	taken off the submission ring if the completions not yet read,
+//	plus the requests in flight, leave a free slot for it.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "ioring.h"
+
+#include "addrspace.h"
+#include "copyright.h"
+#include "fdtable.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// AsyncIoRing::AsyncIoRing
+//	Set up the kernel's side of a ring.  Reset() must be called to
+//	check the user's side before it is used.
+//
+//	"addrSpace" is the memory of the program owning the ring, and
+//	"fileTable" the files it has open.
+//	"ringAddr" is the user address of its IoRing.
+//----------------------------------------------------------------------
+
+AsyncIoRing::AsyncIoRing(AddrSpace *addrSpace, FdTable *fileTable, int ringAddr) {
+    space = addrSpace;
+    files = fileTable;
+    ring = ringAddr;
+    inFlight = 0;
+    faulted = FALSE;
+    lock = new Lock("io ring");
+    completed = new Condition("io ring completions");
+}
+
+//----------------------------------------------------------------------
+// AsyncIoRing::~AsyncIoRing
+//	De-allocate the ring.  No worker may still be using it.
+//----------------------------------------------------------------------
+
+AsyncIoRing::~AsyncIoRing() {
+    ASSERT(inFlight == 0);
+    delete completed;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// AsyncIoRing::ReadWord, AsyncIoRing::WriteWord
+//	Access word "index" of the IoRing in user memory.  Reset() made
+//	sure the whole ring was there, but the program may have unmapped
+//	it since (by detaching a shared segment, or ending the thread
+//	whose stack held it).  If so, "faulted" is set, reads return 0,
+//	and writes are dropped; the ring can't be used any more.
+//----------------------------------------------------------------------
+
+int AsyncIoRing::ReadWord(int index) {
+    unsigned int word;
+
+    if (!space->CopyIn(ring + index * 4, (char *)&word, 4)) {
+        faulted = TRUE;
+        return 0;
+    }
+    return WordToHost(word);
+}
+
+void AsyncIoRing::WriteWord(int index, int value) {
+    unsigned int word = WordToMachine((unsigned int)value);
+
+    if (!space->CopyOut(ring + index * 4, (char *)&word, 4)) {
+        faulted = TRUE;
+    }
+}
+
+//----------------------------------------------------------------------
+// AsyncIoRing::Reset
+//	Check that the IoRing is aligned and lies in writable memory,
+//	and empty both rings.  Returns FALSE if the ring can't be used.
+//----------------------------------------------------------------------
+
+bool AsyncIoRing::Reset() {
+    char *contents = new char[IoRingWords * 4];
+    bool ok = (ring & 0x3) == 0 &&
+              space->CopyIn(ring, contents, IoRingWords * 4) &&
+              space->CopyOut(ring, contents, IoRingWords * 4);
+
+    delete[] contents;
+    faulted = FALSE;
+    if (ok) {
+        WriteWord(IoRingSqHead, 0);
+        WriteWord(IoRingSqTail, 0);
+        WriteWord(IoRingCqHead, 0);
+        WriteWord(IoRingCqTail, 0);
+    }
+    return ok;
+}
+
+//----------------------------------------------------------------------
+// AsyncIoRing::Post
+//	Add a result to the completion ring.  The entry is filled in
+//	before the tail moves, so the program never sees half of it.
+//	The caller holds the lock.
+//----------------------------------------------------------------------
+
+void AsyncIoRing::Post(int userData, int result) {
+    int tail = ReadWord(IoRingCqTail);
+    int entry = IoRingCqStart + (tail & (IoRingEntries - 1)) * IoCompletionWords;
+
+    WriteWord(entry, userData);
+    WriteWord(entry + 1, result);
+    WriteWord(IoRingCqTail, tail + 1);
+}
+
+//----------------------------------------------------------------------
+// AsyncIoRing::Enter
+//	Take up to "toSubmit" new requests off the submission ring and
+//	hand them to the workers, then wait until at least "minComplete"
+//	results are waiting on the completion ring (or nothing is left
+//	in flight).  No-ops, and requests with a bad opcode or a file
+//	that is not open, complete right away.  The file of a request
+//	is looked up here, so closing it meanwhile does not affect it.
+//
+//	Returns the number of requests taken.  Fewer than "toSubmit" are
+//	taken if the submission ring runs out, or the completion ring
+//	has no room left for their results.  Returns EFAULT if the ring
+//	is no longer in the program's memory.
+//----------------------------------------------------------------------
+
+int AsyncIoRing::Enter(int toSubmit, int minComplete) {
+    int submitted = 0;
+
+    lock->Acquire();
+    int head = ReadWord(IoRingSqHead);
+    int tail = ReadWord(IoRingSqTail);
+    while (!faulted && submitted < toSubmit && head != tail &&
+           inFlight + ReadWord(IoRingCqTail) - ReadWord(IoRingCqHead) < IoRingEntries) {
+        int entry = IoRingSqStart + (head & (IoRingEntries - 1)) * IoSubmissionWords;
+        IoRequest *request = new IoRequest;
+
+        request->ring = this;
+        request->opcode = ReadWord(entry);
+        request->fd = ReadWord(entry + 1);
+        request->buffer = ReadWord(entry + 2);
+        request->size = ReadWord(entry + 3);
+        request->offset = ReadWord(entry + 4);
+        request->userData = ReadWord(entry + 5);
+        if (faulted) {
+            delete request;
+            break;
+        }
+        head++;
+        submitted++;
+
+        request->file = files->Lookup(request->fd);
+        if (request->opcode != IoRead && request->opcode != IoWrite) {
+            Post(request->userData, request->opcode == IoNop ? 0 : EINVAL);
+            delete request;
+        } else if (request->file == NULL) {
+            Post(request->userData, EBADF);
+            delete request;
+        } else {
+            request->file->Hold();
+            inFlight++;
+            kernel->ioService->Submit(request);
+        }
+    }
+    WriteWord(IoRingSqHead, head);
+    DEBUG(dbgSys, "Io ring took " << submitted << " requests, " << inFlight << " in flight");
+
+    while (!faulted && inFlight > 0 &&
+           ReadWord(IoRingCqTail) - ReadWord(IoRingCqHead) < minComplete) {
+        completed->Wait(lock);
+    }
+    if (faulted) {
+        DEBUG(dbgSys, "Io ring at " << ring << " is no longer mapped");
+        submitted = EFAULT;
+    }
+    lock->Release();
+    return submitted;
+}
+
+//----------------------------------------------------------------------
+// AsyncIoRing::Complete
+//	Post the result of a request, and wake up anyone waiting for
+//	completions.  Called by the worker that carried it out.  If the
+//	ring has gone, the result is dropped; the waiters see "faulted".
+//----------------------------------------------------------------------
+
+void AsyncIoRing::Complete(IoRequest *request, int result) {
+    lock->Acquire();
+    Post(request->userData, result);
+    inFlight--;
+    completed->Broadcast(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// AsyncIoRing::Drain
+//	Wait until every request taken off the ring has completed, so
+//	that the program's memory can safely go away.
+//----------------------------------------------------------------------
+
+void AsyncIoRing::Drain() {
+    lock->Acquire();
+    while (inFlight > 0) {
+        completed->Wait(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// IoService::IoService, IoService::~IoService
+//	Initialize and de-allocate the request queue.  The workers are
+//	only forked when the first request comes in, so that kernels
+//	not using asynchronous I/O schedule exactly as before.
+//----------------------------------------------------------------------
+
+IoService::IoService() {
+    requests = new SynchList<IoRequest *>;
+    started = FALSE;
+}
+
+IoService::~IoService() {
+    delete requests;
+}
+
+//----------------------------------------------------------------------
+// IoService::Submit
+//	Queue a request for the next free worker.
+//----------------------------------------------------------------------
+
+void IoService::Submit(IoRequest *request) {
+    if (!started) {
+        started = TRUE;
+        for (int i = 0; i < NumIoWorkers; i++) {
+            Thread *worker = new Thread("io worker", 0);
+            worker->Fork((VoidFunctionPtr)IoService::Worker, (void *)this);
+        }
+    }
+    requests->Append(request);
+}
+
+//----------------------------------------------------------------------
+// IoService::Worker
+//	Body of a worker thread: carry out requests, one at a time,
+//	forever.  While one worker waits for the disk, the others keep
+//	going, so a program can have several requests in flight.
+//----------------------------------------------------------------------
+
+void IoService::Worker(IoService *service) {
+    for (;;) {
+        IoRequest *request = service->requests->RemoveFront();
+        int result = Perform(request);
+
+        request->ring->Complete(request, result);
+        request->file->Release();
+        delete request;
+    }
+}
+
+//----------------------------------------------------------------------
+// IoService::Perform
+//	Carry out one read or write, going through a kernel buffer like
+//	the Read and Write system calls do.  A negative offset means the
+//	file's seek position.  Pipes are refused: a worker waiting on
+//	one could hold up the program's exit for good.
+//
+//	Returns the number of bytes transferred, or a negative error.
+//----------------------------------------------------------------------
+
+int IoService::Perform(IoRequest *request) {
+    AddrSpace *space = request->ring->space;
+    FileHandle *handle = request->file;
+    int result;
+
+    if (request->size < 0 || request->size > space->Size()) {
+        return EINVAL;  // not a buffer in the program's memory
+    }
+    if (handle->pipe != NULL) {
+        return ESPIPE;
+    }
+    char *buffer = new char[request->size];
+    if (request->opcode == IoWrite) {
+        if (!space->CopyIn(request->buffer, buffer, request->size)) {
+            result = EFAULT;
+        } else if (request->offset < 0) {
+            result = handle->file->Write(buffer, request->size);
+        } else {
+            result = handle->file->WriteAt(buffer, request->size, request->offset);
+        }
+    } else {
+        if (request->offset < 0) {
+            result = handle->file->Read(buffer, request->size);
+        } else {
+            result = handle->file->ReadAt(buffer, request->size, request->offset);
+        }
+        if (result > 0 && !space->CopyOut(request->buffer, buffer, result)) {
+            result = EFAULT;
+        }
+    }
+    delete[] buffer;
+    return result;
+}
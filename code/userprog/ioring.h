@@ -0,0 +1,114 @@
+// ioring.h
+//	Data structures for asynchronous I/O through rings shared with
+//	user space.
+//
+//	A user program sets aside an IoRing (see syscall.h) in its own
+//	memory and registers it with IoSetup.  It queues requests by
+//	filling in submission entries and moving the submission tail;
+//	IoEnter hands all the new ones to the kernel in one trap, and
+//	can wait for some of them to finish.  Kernel worker threads
+//	carry out the requests, and post the results on the completion
+//	ring, where the program picks them up without trapping.
+//
+//	The kernel reads and writes the ring directly in the program's
+//	memory; the layout below must match the one in syscall.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IORING_H
+#define IORING_H
+
+#include "copyright.h"
+#include "synch.h"
+#include "synchlist.h"
+#include "syscall.h"
+
+class AddrSpace;
+class AsyncIoRing;
+class FdTable;
+class FileHandle;
+
+// Layout of an IoRing in user memory, in words.
+
+const int IoRingSqHead = 0;        // next submission the kernel takes
+const int IoRingSqTail = 1;        // next submission the program fills in
+const int IoRingCqHead = 2;        // next completion the program reads
+const int IoRingCqTail = 3;        // next completion the kernel posts
+const int IoSubmissionWords = 6;   // opcode, fd, buffer, size, offset, userData
+const int IoCompletionWords = 2;   // userData, result
+const int IoRingSqStart = 4;
+const int IoRingCqStart = IoRingSqStart + IoRingEntries * IoSubmissionWords;
+const int IoRingWords = IoRingCqStart + IoRingEntries * IoCompletionWords;
+
+const int NumIoWorkers = 4;  // kernel threads carrying out requests
+
+// The following class defines one request taken off a submission ring.
+
+class IoRequest {
+   public:
+    AsyncIoRing *ring;  // where to post the completion
+    int opcode;         // IoNop, IoRead or IoWrite
+    int fd;
+    FileHandle *file;   // what "fd" referred to, held until the
+                        // request completes
+    int buffer;         // user address
+    int size;
+    int offset;         // byte offset in the file, or -1 for the
+                        // current position
+    int userData;       // handed back as is
+};
+
+// The following class defines the kernel's view of a process's ring.
+
+class AsyncIoRing {
+   public:
+    AsyncIoRing(AddrSpace *addrSpace, FdTable *fileTable, int ringAddr);
+    ~AsyncIoRing();
+
+    bool Reset();  // empty both rings; FALSE if the ring is
+                   // not all in writable memory
+    int Enter(int toSubmit, int minComplete);
+    // hand new submissions to the workers,
+    // then wait for completions; EFAULT if
+    // the ring is no longer mapped
+    void Complete(IoRequest *request, int result);
+    // post a result, called by the workers
+    void Drain();  // wait until no request is in flight
+
+    AddrSpace *space;  // the program's memory
+    FdTable *files;    // ... and its open files
+
+   private:
+    int ring;              // user address of the IoRing
+    bool faulted;          // the ring was found unmapped
+    int inFlight;          // requests taken but not yet completed
+    Lock *lock;            // protects inFlight and the completion ring
+    Condition *completed;  // signalled on every completion
+
+    int ReadWord(int index);
+    void WriteWord(int index, int value);
+    void Post(int userData, int result);  // add to the completion ring
+};
+
+// The following class defines the pool of kernel threads that carry
+// out requests from all rings.
+
+class IoService {
+   public:
+    IoService();   // no workers yet
+    ~IoService();  // de-allocate the request queue
+
+    void Submit(IoRequest *request);  // queue a request, starting the
+                                      // workers on first use
+
+   private:
+    SynchList<IoRequest *> *requests;  // waiting for a worker
+    bool started;                      // workers forked yet?
+
+    static void Worker(IoService *service);
+    static int Perform(IoRequest *request);
+};
+
+#endif  // IORING_H
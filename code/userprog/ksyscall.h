@@ -11,7 +11,11 @@
 #ifndef __USERPROG_KSYSCALL_H__
 #define __USERPROG_KSYSCALL_H__
 
+#include "fdtable.h"
+#include "ioring.h"
 #include "kernel.h"
+#include "pipe.h"
+#include "shm.h"
 #include "synchconsole.h"
 
 void SysHalt() {
@@ -35,22 +39,339 @@ int SysCreate(char *filename) {
     return kernel->fileSystem->Create(filename);
 }
 
+// The open file "id" of the calling process, held so that it stays
+// open while the system call uses it; the caller releases it.  NULL
+// if "id" is not open.
+
+FileHandle *HoldFile(OpenFileId id) {
+    Process *process = kernel->currentThread->process;
+    FileHandle *handle;
+
+    if (process == NULL) {
+        return NULL;
+    }
+    handle = process->files->Lookup(id);
+    if (handle != NULL) {
+        handle->Hold();
+    }
+    return handle;
+}
+
 int SysOpen(char *filename) {
     // return value
-    // 1: success
-    // 0: failed
-    return kernel->fileSystem->OpenAFile(filename);
+    // the lowest free OpenFileId: success
+    // -1: no such file, EMFILE: too many open
+    Process *process = kernel->currentThread->process;
+    OpenFile *file;
+
+    if (process == NULL) {
+        return EMFILE;
+    }
+    file = kernel->fileSystem->Open(filename);
+    if (file == NULL) {
+        return -1;
+    }
+    FileHandle *handle = new FileHandle(file);
+    int id = process->files->Install(handle);
+
+    if (id < 0) {
+        handle->Release();
+    }
+    return id;
 }
 
 int SysWrite(char *buffer, int size, OpenFileId id) {
-    return kernel->fileSystem->WriteAFile(buffer, size, id);
+    FileHandle *handle;
+    int result = EBADF;
+
+    if (id == SysConsoleOutput) {
+        kernel->synchConsoleOut->PutBuffer(buffer, size);
+        return size;
+    }
+    handle = HoldFile(id);
+    if (handle == NULL) {
+        return EBADF;
+    }
+    if (handle->file != NULL) {
+        result = handle->file->Write(buffer, size);
+    } else if (handle->writeEnd) {
+        result = handle->pipe->Write(NULL, 0, buffer, size);
+    }
+    handle->Release();
+    return result;
 }
 
 int SysRead(char *buffer, int size, OpenFileId id) {
-    return kernel->fileSystem->ReadAFile(buffer, size, id);
+    FileHandle *handle;
+    int result = EBADF;
+
+    if (id == SysConsoleInput) {
+        return kernel->synchConsoleIn->GetBuffer(buffer, size);
+    }
+    handle = HoldFile(id);
+    if (handle == NULL) {
+        return EBADF;
+    }
+    if (handle->file != NULL) {
+        result = handle->file->Read(buffer, size);
+    } else if (!handle->writeEnd) {
+        result = handle->pipe->Read(NULL, 0, buffer, size);
+    }
+    handle->Release();
+    return result;
+}
+
+// Pipes are read and written straight from user memory, so that
+// whole pages can be remapped rather than copied.
+
+bool SysIsPipe(OpenFileId id) {
+    Process *process = kernel->currentThread->process;
+    FileHandle *handle = (process != NULL) ? process->files->Lookup(id) : NULL;
+
+    return handle != NULL && handle->pipe != NULL;
+}
+
+int SysWritePipe(int vaddr, int size, OpenFileId id) {
+    FileHandle *handle = HoldFile(id);
+    int result = EBADF;
+
+    if (handle == NULL) {
+        return EBADF;
+    }
+    if (handle->pipe != NULL && handle->writeEnd) {
+        result = handle->pipe->Write(kernel->currentThread->space, vaddr, NULL, size);
+    }
+    handle->Release();
+    return result;
+}
+
+int SysReadPipe(int vaddr, int size, OpenFileId id) {
+    FileHandle *handle = HoldFile(id);
+    int result = EBADF;
+
+    if (handle == NULL) {
+        return EBADF;
+    }
+    if (handle->pipe != NULL && !handle->writeEnd) {
+        result = handle->pipe->Read(kernel->currentThread->space, vaddr, NULL, size);
+    }
+    handle->Release();
+    return result;
+}
+
+int SysPipe(OpenFileId *readId, OpenFileId *writeId) {
+    Process *process = kernel->currentThread->process;
+    PipeBuffer *pipe;
+    FileHandle *readEnd, *writeEnd;
+
+    if (process == NULL) {
+        return EMFILE;
+    }
+    pipe = new PipeBuffer();
+    readEnd = new FileHandle(pipe, FALSE);
+    writeEnd = new FileHandle(pipe, TRUE);
+    *readId = process->files->Install(readEnd);
+    *writeId = (*readId >= 0) ? process->files->Install(writeEnd) : EMFILE;
+    if (*writeId < 0) {
+        if (*readId >= 0) {
+            process->files->Close(*readId);
+        } else {
+            readEnd->Release();
+        }
+        writeEnd->Release();  // the last end: deletes the pipe
+        return EMFILE;
+    }
+    DEBUG(dbgSys, "Pipe " << *readId << " -> " << *writeId);
+    return 0;
+}
+
+int SysSeek(int position, OpenFileId id) {
+    FileHandle *handle = HoldFile(id);
+    int result = position;
+
+    if (handle == NULL) {
+        return EBADF;
+    }
+    if (handle->pipe != NULL) {
+        result = ESPIPE;
+    } else if (position < 0) {
+        result = EINVAL;
+    } else {
+        handle->file->Seek(position);
+    }
+    handle->Release();
+    return result;
+}
+
+int SysPWrite(char *buffer, int size, int offset, OpenFileId id) {
+    FileHandle *handle = HoldFile(id);
+    int result;
+
+    if (handle == NULL) {
+        return EBADF;
+    }
+    if (handle->pipe != NULL) {
+        result = ESPIPE;
+    } else if (offset < 0) {
+        result = EINVAL;
+    } else {
+        result = handle->file->WriteAt(buffer, size, offset);
+    }
+    handle->Release();
+    return result;
+}
+
+int SysPRead(char *buffer, int size, int offset, OpenFileId id) {
+    FileHandle *handle = HoldFile(id);
+    int result;
+
+    if (handle == NULL) {
+        return EBADF;
+    }
+    if (handle->pipe != NULL) {
+        result = ESPIPE;
+    } else if (offset < 0) {
+        result = EINVAL;
+    } else {
+        result = handle->file->ReadAt(buffer, size, offset);
+    }
+    handle->Release();
+    return result;
+}
+
+int SysIoSetup(int ringAddr) {
+    Process *process = kernel->currentThread->process;
+
+    if (process == NULL) {
+        return EINVAL;
+    }
+    if (process->ioRing != NULL) {  // replace the old ring
+        process->ioRing->Drain();
+        delete process->ioRing;
+    }
+    process->ioRing = new AsyncIoRing(process->space, process->files, ringAddr);
+    if (!process->ioRing->Reset()) {
+        delete process->ioRing;
+        process->ioRing = NULL;
+        return EFAULT;
+    }
+    return 0;
+}
+
+int SysIoEnter(int toSubmit, int minComplete) {
+    Process *process = kernel->currentThread->process;
+
+    if (process == NULL || process->ioRing == NULL) {
+        return EINVAL;
+    }
+    return process->ioRing->Enter(toSubmit, minComplete);
+}
+
+int SysShmCreate(int size) {
+    return kernel->shmTable->Create(kernel->currentThread->space, size);
+}
+
+int SysShmAttach(int id, int vaddr) {
+    return kernel->shmTable->Attach(kernel->currentThread->space, id, vaddr);
+}
+
+int SysShmDetach(int vaddr) {
+    return kernel->shmTable->Detach(kernel->currentThread->space, vaddr);
+}
+
+int SysExecV(int argc, char **argv) {
+    Process *parent = kernel->currentThread->process;
+
+    return kernel->Exec(argv[0], parent != NULL ? parent->priority : 0, argc, argv);
+}
+
+int SysExec(char *name) {
+    return SysExecV(1, &name);
+}
+
+int SysJoin(int pid) {
+    Process *process = kernel->currentThread->process;
+
+    if (process == NULL) {
+        return ECHILD;
+    }
+    return process->Join(pid);
+}
+
+int SysThreadFork(int func) {
+    Process *process = kernel->currentThread->process;
+
+    if (process == NULL) {
+        return EINVAL;
+    }
+    return process->ForkThread(func);
+}
+
+void SysThreadYield() {
+    kernel->currentThread->Yield();
+}
+
+int SysThreadJoin(int tid) {
+    Process *process = kernel->currentThread->process;
+
+    if (process == NULL) {
+        return ESRCH;
+    }
+    return process->JoinThread(tid);
+}
+
+void SysThreadExit(int exitCode) {
+    Process *process = kernel->currentThread->process;
+
+    if (process != NULL) {
+        process->FinishThread(exitCode);
+    }
+    kernel->currentThread->Finish();
+}
+
+int SysGetRUsage(ResourceUsage *usage) {
+    Process *process = kernel->currentThread->process;
+
+    if (process == NULL) {
+        return EINVAL;
+    }
+    process->usage.Stop();  // bring it up to date
+    process->usage.Start();
+    process->usage.elapsedTicks = kernel->stats->totalTicks - process->startTick;
+    *usage = process->usage;
+    return 0;
+}
+
+int SysSetRealTime(int period, int budget, int deadline) {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    bool admitted = kernel->scheduler->SetRealTime(kernel->currentThread,
+                                                   period, budget, deadline);
+    (void)kernel->interrupt->SetLevel(oldLevel);
+    return admitted ? 0 : -1;
+}
+
+void SysSleep(int ticks) {
+    kernel->alarm->WaitUntil(ticks);
+}
+
+int SysFutexWait(int addr, int expected) {
+    return kernel->futexTable->Wait(kernel->currentThread->space, addr, expected);
+}
+
+int SysFutexWake(int addr, int count) {
+    return kernel->futexTable->Wake(kernel->currentThread->space, addr, count);
+}
+
+int SysSetAtomicRegion(int begin, int end) {
+    return kernel->currentThread->space->SetAtomicRegion(begin, end) ? 0 : -1;
 }
 
 int SysClose(int id) {
-    return kernel->fileSystem->CloseAFile(id);
+    Process *process = kernel->currentThread->process;
+
+    if (process == NULL) {
+        return EBADF;
+    }
+    return process->files->Close(id);
 }
 #endif /* ! __USERPROG_KSYSCALL_H__ */
@@ -0,0 +1,278 @@
+// pipe.cc
+//	Routines to pass data between user processes through pipes.
+//	See pipe.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "pipe.h"
+
+#include "addrspace.h"
+#include "copyright.h"
+#include "main.h"
+#include "syscall.h"
+
+//----------------------------------------------------------------------
+// PipeBuffer::PipeBuffer
+//	Initialize an empty pipe, with both ends open.
+//----------------------------------------------------------------------
+
+PipeBuffer::PipeBuffer() {
+    buffer = new char[PipeCapacity];
+    head = count = 0;
+    frameHead = numFrames = frameOffset = 0;
+    readerOpen = writerOpen = TRUE;
+    lock = new Lock("pipe");
+    notEmpty = new Condition("pipe not empty");
+    notFull = new Condition("pipe not full");
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::~PipeBuffer
+//	De-allocate a pipe.  Frames loaned to it and never read are
+//	given back to the kernel.
+//----------------------------------------------------------------------
+
+PipeBuffer::~PipeBuffer() {
+    for (int i = 0; i < numFrames; i++) {
+        kernel->ReleasePage(frames[(frameHead + i) % MaxLoanedPages]);
+    }
+    delete[] buffer;
+    delete lock;
+    delete notEmpty;
+    delete notFull;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Deliver, PipeBuffer::Fetch
+//	Copy "size" bytes out of the pipe, to user memory at "vaddr" in
+//	"space" or, if "space" is NULL, to the kernel buffer "into";
+//	and into the pipe, from user memory or from "from".  Return
+//	FALSE if the user address is bad.
+//----------------------------------------------------------------------
+
+bool PipeBuffer::Deliver(AddrSpace *space, int vaddr, char *into, char *from, int size) {
+    kernel->stats->numPipeBytesCopied += size;
+    if (space == NULL) {
+        bcopy(from, into, size);
+        return TRUE;
+    }
+    return space->CopyOut(vaddr, from, size);
+}
+
+bool PipeBuffer::Fetch(AddrSpace *space, int vaddr, char *from, char *into, int size) {
+    kernel->stats->numPipeBytesCopied += size;
+    if (space == NULL) {
+        bcopy(from, into, size);
+        return TRUE;
+    }
+    return space->CopyIn(vaddr, into, size);
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::CanLoan
+//	Can the next page of a write be loaned instead of copied?  It
+//	has to be user memory, and a whole, aligned page.
+//----------------------------------------------------------------------
+
+bool PipeBuffer::CanLoan(AddrSpace *space, int vaddr, int size) {
+    return space != NULL && vaddr % PageSize == 0 && size >= PageSize;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::LoanPage
+//	Share the frame holding the user page at "vaddr" with the pipe.
+//	The page is copy-on-write for the writer from now on, so what
+//	the writer wrote stays in place, and writing the page again
+//	doesn't change what the reader gets.  Returns FALSE if the page
+//	can't be shared (for instance, it is read-only, or shared
+//	memory); the caller then copies it instead.
+//----------------------------------------------------------------------
+
+bool PipeBuffer::LoanPage(AddrSpace *space, int vaddr) {
+    int loaned = space->LoanFrame(vaddr);
+
+    if (loaned < 0) {
+        return FALSE;
+    }
+    frames[(frameHead + numFrames) % MaxLoanedPages] = loaned;
+    numFrames++;
+    kernel->stats->numPipePagesRemapped++;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Read
+//	Wait until the pipe has something in it (or the write end is
+//	closed), then read up to "size" bytes of it.  Loaned frames are
+//	mapped into the reader's address space whenever a whole page
+//	of them lands on a whole, aligned, private page of the reader's
+//	buffer (copy-on-write, while the writer shares the frame too);
+//	otherwise they are copied from.
+//
+//	Returns the number of bytes read, 0 at end of file, or EFAULT
+//	if "vaddr" is bad.  If the caller's process exits while it
+//	waits, returns 0 at once.
+//----------------------------------------------------------------------
+
+int PipeBuffer::Read(AddrSpace *space, int vaddr, char *into, int size) {
+    char *mainMemory = kernel->machine->mainMemory;
+    int done = 0;
+    bool ok = TRUE;
+
+    if (size < 0) {
+        return EINVAL;
+    }
+    kernel->currentThread->SetCancelWait(this);
+    lock->Acquire();
+    while (count == 0 && numFrames == 0 && writerOpen && size > 0 &&
+           !kernel->currentThread->IsExiting()) {
+        notEmpty->Wait(lock);
+    }
+    while (ok && done < size && numFrames > 0) {
+        int frame = frames[frameHead];
+        int replaced = -1;
+        int n;
+
+        if (CanLoan(space, vaddr + done, size - done) && frameOffset == 0) {
+            replaced = space->ExchangeFrame(vaddr + done, frame);
+        }
+        if (replaced >= 0) {  // the pipe's reference is the reader's now
+            kernel->ReleasePage(replaced);
+            kernel->stats->numPipePagesRemapped++;
+            n = PageSize;
+        } else {  // can't be remapped; copy it
+            n = min(size - done, PageSize - frameOffset);
+            ok = Deliver(space, vaddr + done, into + done,
+                         mainMemory + frame * PageSize + frameOffset, n);
+            if (ok && frameOffset + n == PageSize) {  // all of it copied
+                kernel->ReleasePage(frame);
+            }
+        }
+        if (ok) {
+            done += n;
+            frameOffset += n;
+            if (frameOffset == PageSize) {  // done with this frame
+                frameHead = (frameHead + 1) % MaxLoanedPages;
+                numFrames--;
+                frameOffset = 0;
+            }
+        }
+    }
+    while (ok && done < size && count > 0) {
+        int n = min(min(size - done, count), PipeCapacity - head);
+
+        ok = Deliver(space, vaddr + done, into + done, buffer + head, n);
+        if (ok) {
+            head = (head + n) % PipeCapacity;
+            count -= n;
+            done += n;
+        }
+    }
+    if (done > 0) {
+        notFull->Broadcast(lock);
+    }
+    lock->Release();
+    kernel->currentThread->SetCancelWait(NULL);
+    return ok ? done : EFAULT;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Write
+//	Write all "size" bytes to the pipe, waiting for room as needed.
+//	Whole, aligned pages of user memory are loaned to the pipe; the
+//	rest is copied into the ring buffer.
+//
+//	Returns the number of bytes written, which is less than "size"
+//	only if the read end was closed part way (EPIPE if it was closed
+//	before anything was written), or EFAULT if "vaddr" is bad.  If
+//	the caller's process exits while it waits, returns what was
+//	written so far.
+//----------------------------------------------------------------------
+
+int PipeBuffer::Write(AddrSpace *space, int vaddr, char *from, int size) {
+    int done = 0;
+    bool ok = TRUE;
+
+    if (size < 0) {
+        return EINVAL;
+    }
+    kernel->currentThread->SetCancelWait(this);
+    lock->Acquire();
+    while (ok && done < size && !kernel->currentThread->IsExiting()) {
+        if (CanLoan(space, vaddr + done, size - done)) {
+            while (readerOpen && (count > 0 || numFrames == MaxLoanedPages) &&
+                   !kernel->currentThread->IsExiting()) {
+                notFull->Wait(lock);
+            }
+            if (!readerOpen || kernel->currentThread->IsExiting()) {
+                break;
+            }
+            if (LoanPage(space, vaddr + done)) {
+                done += PageSize;
+                notEmpty->Broadcast(lock);
+                continue;
+            }
+        }
+        while (readerOpen && (numFrames > 0 || count == PipeCapacity) &&
+               !kernel->currentThread->IsExiting()) {
+            notFull->Wait(lock);
+        }
+        if (!readerOpen || kernel->currentThread->IsExiting()) {
+            break;
+        }
+        int tail = (head + count) % PipeCapacity;
+        int n = min(min(size - done, PipeCapacity - count), PipeCapacity - tail);
+
+        ok = Fetch(space, vaddr + done, from + done, buffer + tail, n);
+        if (ok) {
+            count += n;
+            done += n;
+            notEmpty->Broadcast(lock);
+        }
+    }
+    lock->Release();
+    kernel->currentThread->SetCancelWait(NULL);
+    if (!ok) {
+        return EFAULT;
+    }
+    return (done == 0 && size > 0) ? EPIPE : done;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::CloseEnd
+//	One end of the pipe is closed: wake up anyone waiting on the
+//	other end, to see end of file, or EPIPE.  Returns TRUE if the
+//	other end is closed too, so the pipe can be deleted.
+//----------------------------------------------------------------------
+
+bool PipeBuffer::CloseEnd(bool writeEnd) {
+    bool bothClosed;
+
+    lock->Acquire();
+    if (writeEnd) {
+        writerOpen = FALSE;
+        notEmpty->Broadcast(lock);
+    } else {
+        readerOpen = FALSE;
+        notFull->Broadcast(lock);
+    }
+    bothClosed = !readerOpen && !writerOpen;
+    lock->Release();
+    return bothClosed;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::CallBack
+//	The process of some thread waiting on the pipe is exiting: wake
+//	up everyone waiting, so that it can give up.  The others just
+//	wait again.
+//----------------------------------------------------------------------
+
+void PipeBuffer::CallBack() {
+    lock->Acquire();
+    notEmpty->Broadcast(lock);
+    notFull->Broadcast(lock);
+    lock->Release();
+}
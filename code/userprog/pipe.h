@@ -0,0 +1,81 @@
+// pipe.h
+//	Data structures for pipes between user processes.
+//
+//	A pipe is a one-way channel: bytes written to its write end come
+//	out of its read end, in order.  Writers block while the pipe is
+//	full, and readers while it is empty; a read returns whatever is
+//	there (at least one byte), or 0 once the write end is closed.
+//	Writing with the read end closed fails with EPIPE.
+//
+//	Small writes are copied into a ring buffer in the kernel.  Whole,
+//	page-aligned pages are instead passed without copying: the
+//	writer's frames are loaned to the pipe, staying mapped in the
+//	writer copy-on-write (see AddrSpace::LoanFrame), and a reader
+//	reading into whole, aligned pages gets the loaned frames mapped
+//	in place of its own, copy-on-write too while the writer still
+//	shares them.  To keep
+//	the data in order, the pipe holds either bytes or loaned pages,
+//	never both at once.
+//
+//	Each end of a pipe is a FileHandle (see fdtable.h), named by a
+//	descriptor in the table of every process sharing it.  The pipe
+//	is deleted once both ends are closed.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "callback.h"
+#include "copyright.h"
+#include "machine.h"
+#include "synch.h"
+
+class AddrSpace;
+
+const int PipeCapacity = 4 * PageSize;  // bytes in the ring buffer
+const int MaxLoanedPages = 8;           // frames a pipe can hold
+
+// The following class defines a pipe: its buffered data, and the
+// state of its two ends.  It is called back when the process of a
+// thread waiting on it exits.
+
+class PipeBuffer : public CallBackObj {
+   public:
+    PipeBuffer();   // an empty pipe, both ends open
+    ~PipeBuffer();  // de-allocate the pipe, and any frames it holds
+
+    int Read(AddrSpace *space, int vaddr, char *into, int size);
+    // read into user memory at "vaddr" in
+    // "space", or into the kernel buffer
+    // "into" if space is NULL
+    int Write(AddrSpace *space, int vaddr, char *from, int size);
+    // write from user memory, or from "from"
+    bool CloseEnd(bool writeEnd);  // wake up anyone waiting on the
+                                   // other end; TRUE once both
+                                   // ends are closed
+    void CallBack();  // wake up everyone waiting, to see whether
+                      // their process is exiting
+
+   private:
+    char *buffer;        // the ring buffer
+    int head;            // where the next byte is read from
+    int count;           // bytes in the ring buffer
+    int frames[MaxLoanedPages];  // loaned frames, a ring too
+    int frameHead;       // the next frame to read from
+    int numFrames;       // frames loaned
+    int frameOffset;     // bytes already read from the first frame
+    bool readerOpen, writerOpen;
+    Lock *lock;             // protects all of the above
+    Condition *notEmpty;    // for readers
+    Condition *notFull;     // for writers
+
+    bool CanLoan(AddrSpace *space, int vaddr, int size);
+    bool LoanPage(AddrSpace *space, int vaddr);
+    bool Deliver(AddrSpace *space, int vaddr, char *into, char *from, int size);
+    bool Fetch(AddrSpace *space, int vaddr, char *from, char *into, int size);
+};
+
+#endif  // PIPE_H
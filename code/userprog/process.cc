@@ -0,0 +1,580 @@
+// process.cc
+//	Routines to manage user processes and the process table.
+//
+//	PID 0 is never handed out; it belongs to the main kernel thread.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "process.h"
+
+#include "addrspace.h"
+#include "copyright.h"
+#include "fdtable.h"
+#include "ioring.h"
+#include "main.h"
+#include "synch.h"
+#include "syscall.h"
+
+//----------------------------------------------------------------------
+// Process::Process
+// 	Initialize a process control block.  The caller attaches the
+//	thread and the address space.
+//
+//	"processID" is the PID allocated by the process table.
+//	"processName" is the name of the program, useful for debugging.
+//----------------------------------------------------------------------
+
+Process::Process(int processID, char *processName) {
+    pid = processID;
+    name = new char[strlen(processName) + 1];
+    strcpy(name, processName);
+    thread = NULL;
+    space = NULL;
+    priority = 0;
+    startTick = kernel->stats->totalTicks;
+    exitStatus = 0;
+    ioRing = NULL;
+    status = NULL;
+    exiting = FALSE;
+    files = new FdTable();
+    children = new List<ChildStatus *>;
+    threads = new List<UserThread *>;
+    nextTid = 1;
+    numRunning = numThreads = 0;
+}
+
+//----------------------------------------------------------------------
+// Process::~Process
+// 	Release everything the process still holds: files it forgot
+//	to close, its I/O ring, and its address space.  Then tell the
+//	parent we are gone, and orphan our children; the PIDs of those
+//	already gone, kept for us to join, can be reused now.
+//----------------------------------------------------------------------
+
+Process::~Process() {
+    delete files;  // closing whatever is still open
+    delete ioRing;  // drained by FinishThread()
+    if (space != NULL) {
+        DEBUG(dbgThread, "Deleting addr space for process " << pid);
+        delete space;
+    }
+    if (status != NULL) {
+        status->exitStatus = exitStatus;
+        status->exited = TRUE;
+        status->done->V();
+    }
+    while (!children->IsEmpty()) {
+        ChildStatus *child = children->RemoveFront();
+        Process *orphan = kernel->processTable->Lookup(child->pid);
+        if (!child->exited && orphan != NULL) {
+            orphan->status = NULL;
+        } else {
+            kernel->processTable->FreePid(child->pid);
+        }
+        delete child;
+    }
+    delete children;
+    while (!threads->IsEmpty()) {
+        delete threads->RemoveFront();
+    }
+    delete threads;
+    delete[] name;
+}
+
+//----------------------------------------------------------------------
+// Process::CloseOpenFiles
+// 	Close the files (and pipe ends) the process forgot to close.
+//	Files shared with other processes stay open for them.
+//	The last thread to finish does this while the process is still
+//	running, since closing a pipe end may have to wait for its lock.
+//----------------------------------------------------------------------
+
+void Process::CloseOpenFiles() {
+    DEBUG(dbgSys, "Closing the files left open by process " << pid);
+    files->CloseAll();
+}
+
+//----------------------------------------------------------------------
+// Process::AddThread
+// 	Start keeping track of a thread running the program, which has
+//	its stack at "stackTop" (0 for the program's own stack).
+//----------------------------------------------------------------------
+
+UserThread *
+Process::AddThread(Thread *t, int stackTop) {
+    UserThread *userThread;
+
+    if (threads->NumInList() >= MaxUserThreads) {
+        DropOldThread();
+    }
+    userThread = new UserThread(nextTid++, t, stackTop);
+    threads->Append(userThread);
+    t->process = this;
+    t->space = space;
+    t->userThread = userThread;
+    numRunning++;
+    numThreads++;
+    return userThread;
+}
+
+//----------------------------------------------------------------------
+// Process::DropOldThread
+// 	Forget the oldest thread which is gone, and which nobody is
+//	joining at the moment, to keep the list of threads short.  It
+//	can't be joined any more.  If there is no such thread, the list
+//	grows for now.
+//----------------------------------------------------------------------
+
+void Process::DropOldThread() {
+    ListIterator<UserThread *> iter(threads);
+
+    for (; !iter.IsDone(); iter.Next()) {
+        UserThread *userThread = iter.Item();
+
+        if (userThread->exited && userThread->thread == NULL &&
+            userThread->joiners == 0) {
+            DEBUG(dbgThread, "Process " << pid << " drops thread " << userThread->tid);
+            threads->Remove(userThread);
+            delete userThread;
+            return;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// RunUserThread
+// 	Body of a thread started by ThreadFork: run its procedure.
+//----------------------------------------------------------------------
+
+static void
+RunUserThread(UserThread *userThread) {
+    userThread->thread->space->ExecuteThread(userThread->func,
+                                             userThread->stackTop);
+}
+
+//----------------------------------------------------------------------
+// Process::ForkThread
+// 	Start another thread of the process, running the user procedure
+//	at "func" on a stack of its own, at the priority of the thread
+//	forking it.  Returns its ThreadId, EAGAIN if the process has
+//	MaxUserThreads running already (or is exiting), or ENOMEM if
+//	there is no memory for the stack.
+//----------------------------------------------------------------------
+
+int Process::ForkThread(int func) {
+    Thread *t;
+    UserThread *userThread;
+    int stackTop;
+
+    if (numRunning >= MaxUserThreads || exiting) {
+        return EAGAIN;
+    }
+    stackTop = space->AddStack();
+    if (stackTop < 0) {
+        return ENOMEM;
+    }
+    t = new Thread(name, pid);
+    t->setPriority(kernel->currentThread->getBasePriority());
+    t->setIsExec();
+    userThread = AddThread(t, stackTop);
+    userThread->func = func;
+    DEBUG(dbgThread, "Process " << pid << " forks thread " << userThread->tid);
+    t->Fork((VoidFunctionPtr)RunUserThread, (void *)userThread);
+    return userThread->tid;
+}
+
+//----------------------------------------------------------------------
+// Process::JoinThread
+// 	Wait until thread "tid" of the process has exited, and return
+//	its exit code.  Any number of threads can join the same thread.
+//	Returns ESRCH if there is no such thread (or it is long gone, see
+//	DropOldThread), or EDEADLK if it is the caller.  If the process
+//	exits meanwhile, returns ESRCH as well; the caller finishes on
+//	its way back to user code anyway.
+//----------------------------------------------------------------------
+
+int Process::JoinThread(int tid) {
+    ListIterator<UserThread *> iter(threads);
+
+    for (; !iter.IsDone(); iter.Next()) {
+        UserThread *userThread = iter.Item();
+        if (userThread->tid == tid) {
+            if (userThread == kernel->currentThread->userThread) {
+                return EDEADLK;
+            }
+            int result;
+
+            userThread->joiners++;
+            userThread->done->P();
+            userThread->done->V();  // for the next joiner
+            result = userThread->exited ? userThread->exitCode : ESRCH;
+            userThread->joiners--;
+            return result;
+        }
+    }
+    return ESRCH;
+}
+
+//----------------------------------------------------------------------
+// Process::Exit
+// 	The current thread calls Exit: the whole process ends, with
+//	exit status "status" (unless another thread got there first).
+//	Wake up the other threads blocked where they could wait forever,
+//	so that they finish too, then finish the current thread.  The
+//	caller then calls Thread::Finish().
+//----------------------------------------------------------------------
+
+void Process::Exit(int status) {
+    if (!exiting) {
+        ListIterator<UserThread *> iter(threads);
+
+        exitStatus = status;
+        exiting = TRUE;  // the other threads finish too
+        for (; !iter.IsDone(); iter.Next()) {
+            UserThread *userThread = iter.Item();
+
+            if (!userThread->exited) {
+                userThread->done->V();  // for threads joining it
+                if (userThread->cancelWait != NULL) {
+                    userThread->cancelWait->CallBack();
+                }
+            }
+        }
+    }
+    FinishThread(exitStatus);
+}
+
+//----------------------------------------------------------------------
+// Process::FinishThread
+// 	The current thread is done, with "exitCode": free its stack,
+//	and wake up whoever joins it.  The last thread to finish also
+//	waits for its I/O requests, and closes the files still open.
+//	The caller then calls Thread::Finish().
+//----------------------------------------------------------------------
+
+void Process::FinishThread(int exitCode) {
+    UserThread *userThread = kernel->currentThread->userThread;
+
+    ASSERT(userThread != NULL && !userThread->exited);
+    DEBUG(dbgThread, "Thread " << userThread->tid << " of process " << pid
+                     << " exits with " << exitCode << ": "
+                     << kernel->stats->totalTicks - userThread->startTick
+                     << " ticks, " << userThread->syscalls.count << " system calls");
+    if (userThread->stackTop != 0) {
+        space->RemoveStack(userThread->stackTop);
+    }
+    userThread->exitCode = exitCode;
+    userThread->exited = TRUE;
+    userThread->done->V();
+    if (--numRunning == 0) {
+        if (ioRing != NULL) {
+            ioRing->Drain();  // workers may still use its memory
+        }
+        CloseOpenFiles();
+    }
+}
+
+//----------------------------------------------------------------------
+// Process::RemoveThread
+// 	Thread "t" of the process is being deleted.  Returns TRUE if it
+//	was the last one, so the process can go away.
+//----------------------------------------------------------------------
+
+bool Process::RemoveThread(Thread *t) {
+    if (thread == t) {
+        thread = NULL;
+    }
+    if (t->userThread != NULL) {
+        t->userThread->thread = NULL;  // its record may be dropped now
+    }
+    return --numThreads == 0;
+}
+
+//----------------------------------------------------------------------
+// Process::AddChild
+// 	Start keeping track of a process we started, so that we can
+//	Join it.
+//----------------------------------------------------------------------
+
+void Process::AddChild(Process *child) {
+    ASSERT(child->status == NULL);
+    child->status = new ChildStatus(child->getID());
+    children->Append(child->status);
+}
+
+//----------------------------------------------------------------------
+// Process::Join
+// 	Wait until child "childID" has exited (and its resources have
+//	been released), and return its exit status.  A child can only be
+//	joined once; its PID, reserved until then, is freed.  Returns
+//	ECHILD if "childID" is not a child we have not joined yet, or
+//	another thread is joining it.
+//
+//	If our process exits meanwhile, returns ECHILD as well, and the
+//	child is put back for ~Process to orphan or free; the caller
+//	finishes on its way back to user code anyway.
+//----------------------------------------------------------------------
+
+int Process::Join(int childID) {
+    ListIterator<ChildStatus *> iter(children);
+    ChildStatus *child = NULL;
+    int result;
+
+    for (; !iter.IsDone(); iter.Next()) {
+        if (iter.Item()->pid == childID) {
+            child = iter.Item();
+            break;
+        }
+    }
+    if (child == NULL) {
+        return ECHILD;
+    }
+    children->Remove(child);  // nobody else joins it meanwhile
+    kernel->currentThread->SetCancelWait(child);
+    if (!kernel->currentThread->IsExiting()) {
+        child->done->P();
+    }
+    kernel->currentThread->SetCancelWait(NULL);
+    if (kernel->currentThread->IsExiting()) {
+        children->Append(child);
+        return ECHILD;
+    }
+    result = child->exitStatus;
+    kernel->processTable->FreePid(child->pid);
+    delete child;
+    return result;
+}
+
+//----------------------------------------------------------------------
+// ResourceUsage::ResourceUsage
+// 	Initialize the accounting of a new process.
+//----------------------------------------------------------------------
+
+ResourceUsage::ResourceUsage() {
+    userTicks = systemTicks = instructions = pageFaults = 0;
+    diskReads = diskWrites = 0;
+    consoleCharsRead = consoleCharsWritten = 0;
+    contextSwitches = elapsedTicks = 0;
+}
+
+//----------------------------------------------------------------------
+// ResourceUsage::Start, ResourceUsage::Stop
+// 	Called by the scheduler as a thread of the process is switched
+//	in and out.  Stop() adds up how far the machine's counters have
+//	moved since Start().  To bring the counts up to date while the
+//	process runs, call Stop() then Start().  Console characters are
+//	charged as they are handed over instead, by SynchConsoleInput
+//	and SynchConsoleOutput.
+//----------------------------------------------------------------------
+
+void ResourceUsage::Start() {
+    since = *kernel->stats;
+}
+
+void ResourceUsage::Stop() {
+    Statistics *stats = kernel->stats;
+
+    userTicks += stats->userTicks - since.userTicks;
+    systemTicks += stats->systemTicks - since.systemTicks;
+    instructions += stats->numInstructions - since.numInstructions;
+    pageFaults += stats->numPageFaults - since.numPageFaults;
+    diskReads += stats->numDiskReads - since.numDiskReads;
+    diskWrites += stats->numDiskWrites - since.numDiskWrites;
+}
+
+//----------------------------------------------------------------------
+// UserThread::UserThread, UserThread::~UserThread
+// 	Create and delete the record of a thread of a process.
+//----------------------------------------------------------------------
+
+UserThread::UserThread(int threadID, Thread *t, int stack) {
+    tid = threadID;
+    thread = t;
+    stackTop = stack;
+    func = 0;
+    exitCode = 0;
+    exited = FALSE;
+    done = new Semaphore("thread exited", 0);
+    joiners = 0;
+    cancelWait = NULL;
+    startTick = kernel->stats->totalTicks;
+}
+
+UserThread::~UserThread() {
+    delete done;
+}
+
+//----------------------------------------------------------------------
+// ChildStatus::ChildStatus, ChildStatus::~ChildStatus
+// 	Create and delete what a parent knows of a child.
+//----------------------------------------------------------------------
+
+ChildStatus::ChildStatus(int childID) {
+    pid = childID;
+    exitStatus = 0;
+    exited = FALSE;
+    done = new Semaphore("child exited", 0);
+}
+
+ChildStatus::~ChildStatus() {
+    delete done;
+}
+
+//----------------------------------------------------------------------
+// ChildStatus::CallBack
+// 	The process of the thread joining this child exits: wake the
+//	thread up, as if the child were gone.  Join() tells the two
+//	apart by IsExiting().
+//----------------------------------------------------------------------
+
+void ChildStatus::CallBack() {
+    done->V();
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::ProcessTable
+// 	Initialize an empty process table.
+//----------------------------------------------------------------------
+
+ProcessTable::ProcessTable() {
+    tableSize = InitialProcessSlots;
+    table = new Process *[tableSize];
+    for (int i = 0; i < tableSize; i++) {
+        table[i] = NULL;
+    }
+    nextPid = 1;  // PID 0 is the main thread
+    freePids = new List<int>;
+    numProcesses = 0;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::~ProcessTable
+// 	De-allocate the process table.  Processes still alive at
+//	this point are deleted as well.
+//----------------------------------------------------------------------
+
+ProcessTable::~ProcessTable() {
+    for (int i = 0; i < tableSize; i++) {
+        if (table[i] != NULL) {
+            Process *process = table[i];
+            table[i] = NULL;
+            process->thread = NULL;
+            delete process;
+        }
+    }
+    delete[] table;
+    delete freePids;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Create
+// 	Allocate a PID and a process control block for it.  The oldest
+//	free PID is recycled once PidReuseDelay PIDs are waiting (or no
+//	new PID is left); otherwise the next new PID is taken, growing
+//	the table if needed.  Returns NULL if MaxProcesses processes are
+//	already alive.
+//
+//	"name" is the name of the program.
+//----------------------------------------------------------------------
+
+Process *
+ProcessTable::Create(char *name) {
+    int pid;
+
+    if (freePids->NumInList() >= PidReuseDelay ||
+        (nextPid == MaxProcesses && !freePids->IsEmpty())) {
+        pid = freePids->RemoveFront();
+    } else if (nextPid < MaxProcesses) {
+        pid = nextPid++;
+        if (pid >= tableSize) {
+            Grow();
+        }
+    } else {
+        return NULL;
+    }
+
+    ASSERT(table[pid] == NULL);
+    table[pid] = new Process(pid, name);
+    numProcesses++;
+    DEBUG(dbgThread, "Created process " << pid << ": " << name);
+    return table[pid];
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Destroy
+// 	Delete a process.  Its PID goes on the free list, unless the
+//	parent has yet to join it: then it stays reserved, so the
+//	parent never finds another process under it, until the parent
+//	joins it or exits (see FreePid).
+//----------------------------------------------------------------------
+
+void ProcessTable::Destroy(Process *process) {
+    int pid = process->getID();
+    bool joinable = (process->status != NULL);
+
+    ASSERT(pid > 0 && pid < tableSize && table[pid] == process);
+    DEBUG(dbgThread, "Destroying process " << pid << ": " << process->getName());
+    kernel->syscallStats->ProcessExited(process);
+    table[pid] = NULL;
+    numProcesses--;
+    delete process;
+    if (!joinable) {
+        FreePid(pid);
+    }
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::FreePid
+// 	PID "pid", of a process which is gone, can be reused.
+//----------------------------------------------------------------------
+
+void ProcessTable::FreePid(int pid) {
+    ASSERT(pid > 0 && pid < tableSize && table[pid] == NULL);
+    freePids->Append(pid);
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Lookup
+// 	Return the process with the given PID, or NULL if there is
+//	no such (live) process.
+//----------------------------------------------------------------------
+
+Process *
+ProcessTable::Lookup(int pid) {
+    if (pid <= 0 || pid >= tableSize) {
+        return NULL;
+    }
+    return table[pid];
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Apply
+// 	Call "func" on every live process, in PID order.
+//----------------------------------------------------------------------
+
+void ProcessTable::Apply(void (*func)(Process *)) {
+    for (int i = 0; i < tableSize; i++) {
+        if (table[i] != NULL) {
+            (*func)(table[i]);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Grow
+// 	Double the size of the table, keeping the existing entries.
+//----------------------------------------------------------------------
+
+void ProcessTable::Grow() {
+    int newSize = min(tableSize * 2, MaxProcesses);
+    Process **newTable = new Process *[newSize];
+
+    for (int i = 0; i < newSize; i++) {
+        newTable[i] = (i < tableSize) ? table[i] : NULL;
+    }
+    delete[] table;
+    table = newTable;
+    tableSize = newSize;
+}
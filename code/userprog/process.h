@@ -0,0 +1,213 @@
+// process.h
+//	Data structures to keep track of user processes.
+//
+//	A process is a user program being executed: the thread running
+//	it, its address space, the files it has opened, and some
+//	accounting.  Processes are named by a process ID (PID), which
+//	is also the ID of the process's thread.
+//
+//	A process can run several threads, all sharing its address
+//	space; each has its own stack and registers, and is scheduled
+//	like any other kernel thread.  The first thread runs main(); the
+//	others are started by ThreadFork.  A thread ends with ThreadExit,
+//	and its exit code goes to every thread joining it.  Exit, from
+//	any thread, ends the whole process: the other threads finish the
+//	next time they enter the kernel, or are preempted.  Threads
+//	blocked in the kernel, where they could wait forever (joining a
+//	thread or a child, on a pipe, or on a futex), are woken up to
+//	finish too.
+//	The process goes away once its last thread is gone.
+//
+//	A process started by another one (with Exec or ExecV) is its
+//	child: the parent can Join it, to wait for it to exit and get
+//	its exit status.  Children outliving their parent are orphaned;
+//	nobody joins them.
+//
+//	The process table maps PIDs to processes.  It grows on demand,
+//	so the number of processes is bounded only by MaxProcesses, and
+//	PIDs of exited processes are recycled, oldest first.  The PID
+//	of a child stays reserved until its parent joins it or exits,
+//	so the parent never joins a stranger.  Even then, a PID is only
+//	reused once PidReuseDelay others have been freed after it (or
+//	new PIDs have run out), so it is not handed straight back out.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include "callback.h"
+#include "copyright.h"
+#include "list.h"
+#include "stats.h"
+#include "syscallstats.h"
+#include "utility.h"
+
+class Thread;
+class AddrSpace;
+class AsyncIoRing;
+class FdTable;
+class Semaphore;
+
+const int MaxProcesses = 65536;     // upper bound on live processes
+const int InitialProcessSlots = 16;  // initial size of the process table
+const int PidReuseDelay = 16;       // PIDs freed before the oldest is reused
+const int MaxUserThreads = 64;      // threads a process can run at once,
+                                    // and records of threads it keeps
+
+// The following class defines what a parent knows of one of its
+// children.  It is also what wakes up a thread joining the child
+// when the parent exits.
+
+class ChildStatus : public CallBackObj {
+   public:
+    ChildStatus(int childID);  // the child is running
+    ~ChildStatus();
+
+    void CallBack();  // the joiner's process exits; wake it up
+
+    int pid;
+    int exitStatus;   // valid once "exited"
+    bool exited;
+    Semaphore *done;  // V'ed once the child is gone
+};
+
+// The following class accounts for what a process uses.  Most of it
+// is the process's share of the machine-wide Statistics: how much
+// they advance while one of its threads is running (including any
+// interrupts handled meanwhile).  Console input is counted as it is
+// handed to the process instead, since it arrives by interrupt, most
+// likely while some other thread runs.
+
+class ResourceUsage {
+   public:
+    ResourceUsage();  // nothing used yet
+
+    void Start();  // one of our threads is switched in
+    void Stop();   // ... and out: charge what it used
+
+    int userTicks;
+    int systemTicks;
+    int instructions;         // user instructions completed
+    int pageFaults;
+    int diskReads;
+    int diskWrites;
+    int consoleCharsRead;
+    int consoleCharsWritten;
+    int contextSwitches;      // times one of our threads was switched out
+    int elapsedTicks;         // since the process started; only kept
+                              // up to date by GetRUsage
+
+   private:
+    Statistics since;  // the machine's counters as of Start()
+};
+
+// The following class defines a thread of a process, as the other
+// threads of the process see it.  It is kept after the thread is
+// gone, so that the thread can still be joined, until the process
+// goes away or needs room for newer threads: a process keeps the
+// records of MaxUserThreads threads, dropping the oldest gone first.
+
+class UserThread {
+   public:
+    UserThread(int threadID, Thread *t, int stack);
+    ~UserThread();
+
+    int tid;           // ThreadId, unique within the process
+    Thread *thread;    // the kernel thread running it
+    int stackTop;      // its stack (see AddrSpace::AddStack); 0 for
+                       // the first thread, using the program's stack
+    int func;          // user procedure it starts from
+    int exitCode;      // valid once "exited"
+    bool exited;
+    Semaphore *done;   // V'ed as it exits, by each joiner, and when
+                       // the process exits
+    int joiners;       // threads joining it right now
+    CallBackObj *cancelWait;  // wakes it up, while it is blocked
+                              // where Exit has to; NULL otherwise
+    int startTick;     // when it was created
+    SyscallCounter syscalls;  // system calls it made
+};
+
+// The following class defines a process control block.
+
+class Process {
+   public:
+    Process(int processID, char *processName);  // initialize a process,
+                                                // copying the name
+    ~Process();  // release the address space and open files
+
+    int getID() { return pid; }
+    char *getName() { return name; }
+
+    void CloseOpenFiles();  // close whatever is still open
+
+    UserThread *AddThread(Thread *t, int stackTop);
+    // a thread starts running the program
+    int ForkThread(int func);  // start another thread; its ThreadId,
+                               // or a negative error
+    int JoinThread(int tid);   // wait for a thread; its exit code
+    void Exit(int status);     // the current thread ends the process
+    void FinishThread(int exitCode);  // the current thread is done
+    bool RemoveThread(Thread *t);  // "t" is deleted; TRUE if it was
+                                   // the last one
+
+    void AddChild(Process *child);  // "child" was started by us
+    int Join(int childID);  // wait for a child to exit; its exit
+                            // status, or ECHILD if not our child
+                            // (or if we exit meanwhile)
+
+    Thread *thread;    // the thread running the program
+    AddrSpace *space;  // its address space (owned by the process)
+    int priority;      // priority the program was started with
+    int startTick;     // when the process was created
+    int exitStatus;    // value passed to Exit()
+    SyscallCounter syscalls;  // system calls made
+    ResourceUsage usage;      // resources used so far
+    FdTable *files;           // open files, by descriptor
+    AsyncIoRing *ioRing;      // registered by IoSetup, or NULL
+    ChildStatus *status;      // kept by our parent, NULL if none
+    bool exiting;             // Exit() was called by some thread
+
+   private:
+    int pid;
+    char *name;
+    List<ChildStatus *> *children;  // not joined yet
+    List<UserThread *> *threads;    // threads started, gone or not,
+                                    // oldest first
+    int nextTid;         // ThreadId of the next thread started
+    int numRunning;      // threads not finished yet
+    int numThreads;      // threads not deleted yet
+
+    void DropOldThread();  // make room for a new thread's record
+};
+
+// The following class defines the process table.
+
+class ProcessTable {
+   public:
+    ProcessTable();   // initialize an empty process table
+    ~ProcessTable();  // de-allocate the table and all processes in it
+
+    Process *Create(char *name);  // allocate a PID and a process;
+                                  // NULL if MaxProcesses are alive
+    void Destroy(Process *process);  // free the process, recycle its PID
+                                     // unless its parent may join it
+    void FreePid(int pid);           // ... recycle it once joined
+    Process *Lookup(int pid);        // process with this PID, or NULL
+    int NumProcesses() { return numProcesses; }
+    void Apply(void (*func)(Process *));  // call func on every process
+
+   private:
+    Process **table;     // indexed by PID; NULL if the slot is free
+    int tableSize;       // number of slots in "table"
+    int nextPid;         // lowest PID never handed out
+    List<int> *freePids;  // PIDs available for reuse, oldest first
+    int numProcesses;    // number of live processes
+
+    void Grow();  // double the size of "table"
+};
+
+#endif  // PROCESS_H
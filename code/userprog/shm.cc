@@ -0,0 +1,216 @@
+// shm.cc
+//	Routines to share memory between user processes.  See shm.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "shm.h"
+
+#include "addrspace.h"
+#include "copyright.h"
+#include "main.h"
+#include "syscall.h"
+
+//----------------------------------------------------------------------
+// SharedSegment::SharedSegment
+//	Allocate the frames of a segment, and zero them.  The caller
+//	has checked that there are enough free frames.
+//
+//	"numFrames" is the size of the segment, in pages.
+//----------------------------------------------------------------------
+
+SharedSegment::SharedSegment(int numFrames) {
+    numPages = numFrames;
+    frames = new int[numPages];
+    attachCount = 0;
+    owner = NULL;
+    for (int i = 0; i < numPages; i++) {
+        frames[i] = kernel->AllocateFreePage();
+        ASSERT(frames[i] >= 0);
+        bzero(kernel->machine->mainMemory + frames[i] * PageSize, PageSize);
+    }
+}
+
+//----------------------------------------------------------------------
+// SharedSegment::~SharedSegment
+//	Drop the segment's reference to each of its frames.  Frames
+//	still mapped somewhere stay allocated until they are unmapped.
+//----------------------------------------------------------------------
+
+SharedSegment::~SharedSegment() {
+    for (int i = 0; i < numPages; i++) {
+        kernel->ReleasePage(frames[i]);
+    }
+    delete[] frames;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::ShmTable, ShmTable::~ShmTable
+//	Initialize and de-allocate the table of segments.
+//----------------------------------------------------------------------
+
+ShmTable::ShmTable() {
+    for (int i = 0; i < MaxShmSegments; i++) {
+        segments[i] = NULL;
+    }
+    attachments = new List<ShmAttachment *>;
+}
+
+ShmTable::~ShmTable() {
+    while (!attachments->IsEmpty()) {
+        delete attachments->RemoveFront();
+    }
+    delete attachments;
+    for (int i = 0; i < MaxShmSegments; i++) {
+        delete segments[i];
+    }
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Create
+//	Create a segment of "size" bytes (rounded up to whole pages),
+//	filled with zeroes, owned by "space".
+//
+//	Returns the id of the segment, EINVAL if the size is bad, or
+//	ENOMEM if there is not enough memory, or no free segment.
+//----------------------------------------------------------------------
+
+int ShmTable::Create(AddrSpace *space, int size) {
+    int numPages;
+
+    if (size <= 0 || size > MaxShmAddress) {
+        return EINVAL;
+    }
+    numPages = divRoundUp(size, PageSize);
+    if (!kernel->CanAllocatePages(numPages)) {
+        return ENOMEM;
+    }
+    for (int id = 0; id < MaxShmSegments; id++) {
+        if (segments[id] == NULL) {
+            segments[id] = new SharedSegment(numPages);
+            segments[id]->owner = space;
+            DEBUG(dbgAddr, "Shared segment " << id << ": " << numPages << " pages");
+            return id;
+        }
+    }
+    return ENOMEM;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Attach
+//	Map segment "id" into "space" at user address "vaddr", which
+//	must be page aligned and free; 0 means right after the end of
+//	the address space.  Either way, the segment must fit below
+//	MaxShmAddress.
+//
+//	Returns the address the segment is attached at, or EINVAL if
+//	the segment doesn't exist, or the address can't be used.
+//----------------------------------------------------------------------
+
+int ShmTable::Attach(AddrSpace *space, int id, int vaddr) {
+    SharedSegment *segment;
+    ShmAttachment *attachment;
+
+    if (id < 0 || id >= MaxShmSegments || segments[id] == NULL) {
+        return EINVAL;
+    }
+    segment = segments[id];
+    if (vaddr == 0) {  // right after the end of the address space
+        vaddr = space->Size();
+    }
+    if (vaddr < 0 || vaddr > MaxShmAddress - segment->numPages * PageSize) {
+        return EINVAL;
+    }
+    vaddr = space->MapShared(vaddr, segment->frames, segment->numPages);
+    if (vaddr < 0) {
+        return EINVAL;
+    }
+    segment->attachCount++;
+    attachment = new ShmAttachment;
+    attachment->space = space;
+    attachment->vaddr = vaddr;
+    attachment->id = id;
+    attachments->Append(attachment);
+    return vaddr;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Unmap
+//	Undo an attachment, deleting the segment if it is no longer
+//	used.  The caller takes it off the list.
+//----------------------------------------------------------------------
+
+void ShmTable::Unmap(ShmAttachment *attachment) {
+    SharedSegment *segment = segments[attachment->id];
+
+    attachment->space->UnmapShared(attachment->vaddr, segment->numPages);
+    segment->attachCount--;
+    DeleteIfUnused(attachment->id);
+    delete attachment;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::DeleteIfUnused
+//	Delete segment "id" if its owner is gone and nothing has it
+//	attached.
+//----------------------------------------------------------------------
+
+void ShmTable::DeleteIfUnused(int id) {
+    SharedSegment *segment = segments[id];
+
+    if (segment->owner == NULL && segment->attachCount == 0) {
+        DEBUG(dbgAddr, "Deleting shared segment " << id);
+        delete segment;
+        segments[id] = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Detach
+//	Unmap the segment attached to "space" at "vaddr".  Returns 0, or
+//	EINVAL if no segment is attached there.
+//----------------------------------------------------------------------
+
+int ShmTable::Detach(AddrSpace *space, int vaddr) {
+    ListIterator<ShmAttachment *> iter(attachments);
+
+    for (; !iter.IsDone(); iter.Next()) {
+        ShmAttachment *attachment = iter.Item();
+
+        if (attachment->space == space && attachment->vaddr == vaddr) {
+            attachments->Remove(attachment);
+            Unmap(attachment);
+            return 0;
+        }
+    }
+    return EINVAL;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::DetachAll
+//	Unmap every segment attached to "space", which is being
+//	deleted, and give up the segments it owns.
+//----------------------------------------------------------------------
+
+void ShmTable::DetachAll(AddrSpace *space) {
+    List<ShmAttachment *> *others = new List<ShmAttachment *>;
+
+    while (!attachments->IsEmpty()) {
+        ShmAttachment *attachment = attachments->RemoveFront();
+
+        if (attachment->space == space) {
+            Unmap(attachment);
+        } else {
+            others->Append(attachment);
+        }
+    }
+    delete attachments;
+    attachments = others;
+    for (int id = 0; id < MaxShmSegments; id++) {
+        if (segments[id] != NULL && segments[id]->owner == space) {
+            segments[id]->owner = NULL;
+            DeleteIfUnused(id);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+// shm.h
+//	Data structures for memory shared between user processes.
+//
+//	A shared memory segment is a set of physical frames.  ShmCreate
+//	allocates one; ShmAttach maps its frames into the address space
+//	of the caller, at an address of its choosing, and ShmDetach
+//	unmaps them.  Every process attached to a segment sees the same
+//	bytes, without the kernel copying anything.
+//
+//	Frames are reference counted by the kernel's frame allocator:
+//	the segment holds one reference to each of its frames, and each
+//	attachment one more.  The address space which created a segment
+//	owns it until it goes away, so that it can hand the id to other
+//	processes before anyone attaches it.  A segment is deleted once
+//	its owner is gone and no address space has it attached, even if
+//	it was never attached at all.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SHM_H
+#define SHM_H
+
+#include "copyright.h"
+#include "list.h"
+
+class AddrSpace;
+
+const int MaxShmSegments = 32;        // segments in existence at once
+const int MaxShmAddress = 1 << 20;    // segments are attached below this
+
+// The following class defines a shared memory segment.
+
+class SharedSegment {
+   public:
+    SharedSegment(int numFrames);  // allocate and zero the frames
+    ~SharedSegment();              // drop the segment's references
+
+    int numPages;
+    int *frames;      // physical page numbers, -1 if not allocated
+    int attachCount;  // address spaces it is attached to
+    AddrSpace *owner;  // the one which created it, NULL once gone
+};
+
+// The following class defines one attachment of a segment.
+
+class ShmAttachment {
+   public:
+    AddrSpace *space;
+    int vaddr;   // where it is attached
+    int id;      // which segment
+};
+
+// The following class defines the kernel's table of segments.
+
+class ShmTable {
+   public:
+    ShmTable();   // no segments yet
+    ~ShmTable();  // de-allocate the segments left
+
+    int Create(AddrSpace *space, int size);
+    // a new segment of "size" bytes, owned
+    // by "space"; its id, or a negative
+    // error code
+    int Attach(AddrSpace *space, int id, int vaddr);
+    // map segment "id" at vaddr (0: anywhere);
+    // the address, or a negative error code
+    int Detach(AddrSpace *space, int vaddr);
+    // unmap the segment attached at vaddr
+    void DetachAll(AddrSpace *space);  // the address space is going away,
+                                       // with the segments it owns
+
+   private:
+    SharedSegment *segments[MaxShmSegments];  // by id; NULL if free
+    List<ShmAttachment *> *attachments;
+
+    void Unmap(ShmAttachment *attachment);
+    void DeleteIfUnused(int id);  // no owner and no attachments?
+};
+
+#endif  // SHM_H
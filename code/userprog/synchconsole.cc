@@ -22,6 +22,7 @@ SynchConsoleInput::SynchConsoleInput(char *inputFile) {
     consoleInput = new ConsoleInput(inputFile, this);
     lock = new Lock("console in");
     waitFor = new Semaphore("console in", 0);
+    atEnd = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -40,16 +41,62 @@ SynchConsoleInput::~SynchConsoleInput() {
 //      Read a character typed at the keyboard, waiting if necessary.
 //----------------------------------------------------------------------
 
-char SynchConsoleInput::GetChar() {
-    char ch;
+int SynchConsoleInput::GetChar() {
+    int ch;
 
     lock->Acquire();
+    ch = ReadChar();
+    lock->Release();
+    return ch;
+}
+
+//----------------------------------------------------------------------
+// SynchConsoleInput::ReadChar
+//      Wait for a character (or EOF), with the lock held.  Once the
+//	input has ended, there will be no more interrupts to wait for,
+//	so EOF is returned right away.  Characters are returned as
+//	unsigned chars, so that a 0xff byte is not taken for EOF.
+//----------------------------------------------------------------------
+
+int SynchConsoleInput::ReadChar() {
+    int ch;
+
+    if (atEnd) {
+        return EOF;
+    }
     waitFor->P();  // wait for EOF or a char to be available.
     ch = consoleInput->GetChar();
-    lock->Release();
+    if (ch == EOF) {
+        atEnd = TRUE;
+    } else if (kernel->currentThread->process != NULL) {
+        kernel->currentThread->process->usage.consoleCharsRead++;
+    }
     return ch;
 }
 
+//----------------------------------------------------------------------
+// SynchConsoleInput::GetBuffer
+//      Read up to "size" characters into "buffer", stopping after a
+//	newline, like a terminal handing out a line at a time.  Waits
+//	for the first character.  Returns the number of characters
+//	read, 0 at end of file.
+//----------------------------------------------------------------------
+
+int SynchConsoleInput::GetBuffer(char *buffer, int size) {
+    int count = 0;
+    int ch;
+
+    lock->Acquire();
+    while (count < size && (ch = ReadChar()) != EOF) {
+        buffer[count++] = (char)ch;
+        if (ch == '\n') {
+            break;
+        }
+    }
+    lock->Release();
+    return count;
+}
+
 //----------------------------------------------------------------------
 // SynchConsoleInput::CallBack
 //      Interrupt handler called when keystroke is hit; wake up
@@ -85,6 +132,19 @@ SynchConsoleOutput::~SynchConsoleOutput() {
     delete waitFor;
 }
 
+//----------------------------------------------------------------------
+// ChargeWrite
+//      Charge "count" characters written to the current process.  The
+//	device's own counter is bumped at interrupt time, when some
+//	other process may be running, so it can't be used for this.
+//----------------------------------------------------------------------
+
+static void ChargeWrite(int count) {
+    if (kernel->currentThread->process != NULL) {
+        kernel->currentThread->process->usage.consoleCharsWritten += count;
+    }
+}
+
 //----------------------------------------------------------------------
 // SynchConsoleOutput::PutChar
 //      Write a character to the console display, waiting if necessary.
@@ -93,10 +153,29 @@ SynchConsoleOutput::~SynchConsoleOutput() {
 void SynchConsoleOutput::PutChar(char ch) {
     lock->Acquire();
     consoleOutput->PutChar(ch);
+    ChargeWrite(1);
     waitFor->P();
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchConsoleOutput::PutBuffer
+//      Write "size" characters to the console display, handing the
+//	device up to ConsoleChunkSize of them at a time, and waiting
+//	for one interrupt per chunk rather than one per character.
+//	The simulated time is the same either way.
+//----------------------------------------------------------------------
+
+void SynchConsoleOutput::PutBuffer(char *buffer, int size) {
+    lock->Acquire();
+    for (int done = 0; done < size; done += ConsoleChunkSize) {
+        consoleOutput->PutBuffer(buffer + done, min(size - done, ConsoleChunkSize));
+        waitFor->P();
+    }
+    ChargeWrite(size);
+    lock->Release();
+}
+
 void SynchConsoleOutput::PutInt(int value) {
     char str[15];
     int idx = 0;
@@ -108,6 +187,7 @@ void SynchConsoleOutput::PutInt(int value) {
         consoleOutput->PutChar(str[idx]);
         DEBUG(dbgTraCode, "In SynchConsoleOutput::PutChar, return from consoleOutput->PutChar, " << kernel->stats->totalTicks);
         idx++;
+        ChargeWrite(1);
 
         DEBUG(dbgTraCode, "In SynchConsoleOutput::PutChar, into waitFor->P(), " << kernel->stats->totalTicks);
         waitFor->P();
@@ -17,6 +17,8 @@
 #include "synch.h"
 #include "utility.h"
 
+const int ConsoleChunkSize = 128;  // characters per output interrupt
+
 // The following two classes define synchronized input and output to
 // a console device
 
@@ -25,12 +27,18 @@ class SynchConsoleInput : public CallBackObj {
     SynchConsoleInput(char *inputFile);  // Initialize the console device
     ~SynchConsoleInput();                // Deallocate console device
 
-    char GetChar();  // Read a character, waiting if necessary
+    int GetChar();  // Read a character, waiting if necessary;
+                    // EOF at end of file
+    int GetBuffer(char *buffer, int size);
+    // Read up to a newline; 0 at end of file
 
    private:
     ConsoleInput *consoleInput;  // the hardware keyboard
     Lock *lock;                  // only one reader at a time
     Semaphore *waitFor;          // wait for callBack
+    bool atEnd;                  // end of file seen; no more callBacks
+
+    int ReadChar();  // GetChar, with the lock held
 
     void CallBack();  // called when a keystroke is available
 };
@@ -41,6 +49,8 @@ class SynchConsoleOutput : public CallBackObj {
     ~SynchConsoleOutput();
 
     void PutChar(char ch);  // Write a character, waiting if necessary
+    void PutBuffer(char *buffer, int size);
+    // Write "size" characters, a chunk at a time
 
     void PutInt(int n);
 
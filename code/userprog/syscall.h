@@ -35,6 +35,22 @@
 #define SC_ThreadExit 14
 #define SC_ThreadJoin 15
 #define SC_PrintInt 16
+#define SC_SetRealTime 17
+#define SC_Sleep 18
+#define SC_FutexWait 19
+#define SC_FutexWake 20
+#define SC_SetAtomicRegion 21
+#define SC_ReadV 22
+#define SC_WriteV 23
+#define SC_PRead 24
+#define SC_PWrite 25
+#define SC_IoSetup 26
+#define SC_IoEnter 27
+#define SC_Pipe 28
+#define SC_ShmCreate 29
+#define SC_ShmAttach 30
+#define SC_ShmDetach 31
+#define SC_GetRUsage 32
 #define SC_Add 42
 #define SC_MSG 100
 #ifndef IN_ASM
@@ -82,12 +98,20 @@ SpaceId Exec(char *exec_name);
 
 /* Run the executable, stored in the Nachos file "argv[0]", with
  * parameters stored in argv[1..argc-1] and return the
- * address space identifier
+ * address space identifier.  main() gets them as (argc, argv).
+ * The new program is a child of the caller, at the same priority.
+ * Returns ENOENT if there is no such executable, ENOEXEC if it is
+ * not a NOFF program, E2BIG if the arguments are too many or too
+ * long, EAGAIN if no process can be created, or ENOMEM if there is
+ * not enough memory to load the program.  Starting a program run
+ * recently is cheap: the executable is kept in memory, and the code
+ * pages of one already running are shared.
  */
 SpaceId ExecV(int argc, char *argv[]);
 
 /* Only return once the user program "id" has finished.
- * Return the exit status.
+ * Return the exit status, or ECHILD if "id" is not a child of the
+ * caller (or was already joined).
  */
 int Join(SpaceId id);
 
@@ -100,13 +124,17 @@ int Join(SpaceId id);
  * file system has not been implemented.
  */
 
-/* A unique identifier for an open Nachos file. */
+/* A unique identifier for an open Nachos file.  OpenFileIds are
+ * private to the process; one started by Exec or ExecV inherits the
+ * ones its parent has open, sharing their seek positions.
+ */
 typedef int OpenFileId;
 
 /* when an address space starts up, it has two open files, representing
  * keyboard input and display output (in UNIX terms, stdin and stdout).
  * Read and Write can be used directly on these, without first opening
- * the console device.
+ * the console device.  A Read of the console returns at most one line,
+ * and 0 once its input has ended.
  */
 
 #define SysConsoleInput 0
@@ -121,7 +149,9 @@ int Create(char *name);
 int Remove(char *name);
 
 /* Open the Nachos file "name", and return an "OpenFileId" that can
- * be used to read and write to the file.
+ * be used to read and write to the file: the lowest one not in use.
+ * Return a negative error code on failure.  Whatever is still open
+ * is closed when the process exits.
  */
 OpenFileId Open(char *name);
 
@@ -141,9 +171,108 @@ int Read(char *buffer, int size, OpenFileId id);
 
 /* Set the seek position of the open file "id"
  * to the byte "position".
+ * Return the new position, or a negative error code on failure
+ * (ESPIPE for a pipe).
  */
 int Seek(int position, OpenFileId id);
 
+/* Vectored I/O: write the "count" buffers described by "iov", one
+ * after the other, as a single write (or read into them, as a single
+ * read).  At most MaxIoVecs buffers per call.
+ * Return the number of bytes written (or read), negative on failure.
+ */
+typedef struct {
+    char *base;   /* start of the buffer */
+    int length;   /* its size in bytes */
+} IoVec;
+
+#define MaxIoVecs 16
+
+int WriteV(IoVec *iov, int count, OpenFileId id);
+int ReadV(IoVec *iov, int count, OpenFileId id);
+
+/* Positional I/O: like Write and Read, but at byte "offset" of the
+ * file, without using or moving the seek position.
+ */
+int PWrite(char *buffer, int size, int offset, OpenFileId id);
+int PRead(char *buffer, int size, int offset, OpenFileId id);
+
+/* Asynchronous I/O.  The program keeps an IoRing in its own memory,
+ * and registers it with IoSetup.  To queue a request, it fills in
+ * sq[sqTail % IoRingEntries] and increments sqTail; IoEnter then
+ * hands up to "toSubmit" queued requests to the kernel, and waits
+ * until at least "minComplete" results are on the completion ring.
+ * Results are read from cq[cqHead % IoRingEntries], incrementing
+ * cqHead, without any system call.  The kernel moves sqHead and
+ * cqTail; the program moves sqTail and cqHead.
+ *
+ * An offset of -1 reads or writes at the file's seek position.
+ * IoSetup returns 0, or a negative error code if the ring is not
+ * in writable memory.  IoEnter returns the number of requests
+ * taken, which can be less than asked for if the completion ring
+ * would overflow, or EFAULT if the ring is no longer mapped.
+ */
+#define IoRingEntries 16  /* a power of two */
+
+#define IoNop 0
+#define IoRead 1
+#define IoWrite 2
+
+typedef struct {
+    int opcode;       /* IoNop, IoRead or IoWrite */
+    OpenFileId fd;
+    char *buffer;
+    int size;
+    int offset;       /* in the file, or -1 */
+    int userData;     /* copied to the completion */
+} IoSubmission;
+
+typedef struct {
+    int userData;     /* of the request */
+    int result;       /* what Read or Write would have returned */
+} IoCompletion;
+
+typedef struct {
+    int sqHead, sqTail;
+    int cqHead, cqTail;
+    IoSubmission sq[IoRingEntries];
+    IoCompletion cq[IoRingEntries];
+} IoRing;
+
+int IoSetup(IoRing *ring);
+int IoEnter(int toSubmit, int minComplete);
+
+/* Create a pipe: bytes written to fds[1] can be read from fds[0],
+ * by this process and the ones it starts afterwards.  Reads wait
+ * for something to read, and return 0 once every copy of the write
+ * end is closed; writes wait for room, and fail with EPIPE once
+ * every copy of the read end is closed.  Both ends are closed with
+ * Close.
+ *
+ * Whole, page-aligned pages are written without copying them: the
+ * pipe shares the writer's pages, which are copied only if the
+ * writer changes them before they are read.
+ *
+ * Return 0, or a negative error code.
+ */
+int Pipe(OpenFileId fds[2]);
+
+/* Shared memory.  ShmCreate makes a segment of "size" bytes, filled
+ * with zeroes, and returns its id.  ShmAttach maps segment "id" into
+ * the caller's address space at "addr", which must be page aligned
+ * and unused (NULL lets the kernel choose), and returns where it was
+ * attached.  Processes attached to the same segment see the same
+ * memory.  ShmDetach unmaps the segment attached at "addr".  A
+ * segment is deleted once the process which created it is gone, and
+ * no process has it attached.
+ *
+ * On failure, a negative error code is returned (cast to a pointer,
+ * for ShmAttach).
+ */
+int ShmCreate(int size);
+char *ShmAttach(int id, char *addr);
+int ShmDetach(char *addr);
+
 /* Close the file, we're done reading and writing to it.
  * Return 1 on success, negative error code on failure
  */
@@ -156,8 +285,11 @@ int Close(OpenFileId id);
  */
 
 /* Fork a thread to run a procedure ("func") in the *same* address space
- * as the current thread.
+ * as the current thread.  It gets a stack of its own; returning from
+ * "func" is the same as ThreadExit(0).
  * Return a positive ThreadId on success, negative error code on failure
+ * (EAGAIN if the program has too many threads running, ENOMEM if there
+ * is no memory for the stack).  The thread running main() is ThreadId 1.
  */
 ThreadId ThreadFork(void (*func)());
 
@@ -168,15 +300,78 @@ void ThreadYield();
 
 /*
  * Blocks current thread until lokal thread ThreadID exits with ThreadExit.
- * Function returns the ExitCode of ThreadExit() of the exiting thread.
+ * Function returns the ExitCode of ThreadExit() of the exiting thread,
+ * or ESRCH if there is no such thread (EDEADLK if it is the caller).
+ * A program keeps the exit codes of its 64 most recent threads only
+ * (running ones included), so a thread long gone is not found either.
  */
 int ThreadJoin(ThreadId id);
 
 /*
  * Deletes current thread and returns ExitCode to every waiting lokal thread.
+ * The program ends when its last thread does; Exit, called by any
+ * thread, ends all of them.
  */
 void ThreadExit(int ExitCode);
 
+/* Real-time scheduling: from now on, every "period" ticks the calling
+ * thread is given "budget" ticks of CPU time, to be used within
+ * "deadline" ticks (budget <= deadline <= period).  Real-time threads
+ * run earliest deadline first, ahead of all other threads, and are
+ * held back once their budget for the period is used up.
+ * Return 0 on success, or -1 if the request is refused because the
+ * real-time threads together would need more than the whole CPU.
+ */
+int SetRealTime(int period, int budget, int deadline);
+
+/* Block the calling thread for at least "ticks" ticks of simulated time,
+ * without using the CPU.
+ */
+void Sleep(int ticks);
+
+/* Futexes: the building block for user-level locks (see test/usync.h),
+ * which only trap to the kernel to wait or to wake up waiters.
+ *
+ * FutexWait blocks the calling thread if the word at "addr" still holds
+ * "expected", until a FutexWake on the same word.  Returns 0 once woken,
+ * or -1 at once if the word holds something else (or "addr" is bad).
+ *
+ * FutexWake wakes up at most "count" threads waiting on "addr", oldest
+ * first, and returns how many it woke up.
+ */
+int FutexWait(int *addr, int expected);
+int FutexWake(int *addr, int count);
+
+/* Tell the kernel that the code from "begin" up to "end" is a
+ * restartable atomic sequence: a thread switched out in the middle of
+ * it resumes from "begin".  Used by CompareAndSwap in start.S.
+ * Return 0 on success, -1 if the region is not acceptable.
+ */
+int SetAtomicRegion(int begin, int end);
+
+/* Resource usage of the calling process (all of its threads), so far.
+ * Ticks are simulated time; interrupts handled while the process runs
+ * are charged to it.  Asynchronous I/O is done by kernel threads, so
+ * its disk transfers are not counted here.
+ */
+typedef struct {
+    int userTicks;
+    int systemTicks;
+    int instructions;        /* user instructions completed */
+    int pageFaults;
+    int diskReads;           /* sectors */
+    int diskWrites;
+    int consoleCharsRead;
+    int consoleCharsWritten;
+    int contextSwitches;     /* times a thread was switched out */
+    int elapsedTicks;        /* since the process started, running or not */
+} RUsage;
+
+/* Fill in "usage".  Return 0, or a negative error code if "usage" is
+ * not in writable memory.
+ */
+int GetRUsage(RUsage *usage);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
@@ -0,0 +1,210 @@
+// syscallstats.cc
+//	Routines to account for system calls.  See syscallstats.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "syscallstats.h"
+
+#include "copyright.h"
+#include "main.h"
+#include "process.h"
+
+//----------------------------------------------------------------------
+// SyscallCounter::SyscallCounter
+// 	Initialize a counter to no calls.
+//----------------------------------------------------------------------
+
+SyscallCounter::SyscallCounter() {
+    count = returned = totalTicks = maxTicks = 0;
+    hostUsecs = 0;
+    for (int i = 0; i < LatencyBuckets; i++) {
+        histogram[i] = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// SyscallCounter::Returned
+// 	Account for a call that returned after "ticks" simulated ticks,
+//	and "usecs" microseconds of host time.
+//----------------------------------------------------------------------
+
+void SyscallCounter::Returned(int ticks, double usecs) {
+    int bucket = 0;
+
+    returned++;
+    totalTicks += ticks;
+    maxTicks = max(maxTicks, ticks);
+    hostUsecs += usecs;
+    while (ticks > 0 && bucket < LatencyBuckets - 1) {
+        bucket++;
+        ticks >>= 1;
+    }
+    histogram[bucket]++;
+}
+
+//----------------------------------------------------------------------
+// SyscallCounter::Print
+// 	Print the totals on one line, then the non-empty buckets of the
+//	latency histogram.
+//----------------------------------------------------------------------
+
+void SyscallCounter::Print() {
+    cout << count << " calls, " << totalTicks << " ticks (max " << maxTicks;
+    if (returned > 0) {
+        cout << ", avg " << totalTicks / returned << "), host "
+             << (int)(hostUsecs / returned) << " us/call\n";
+    } else {
+        cout << ")\n";
+    }
+    if (returned == 0) {
+        return;
+    }
+    cout << "        ticks:";
+    for (int b = 0; b < LatencyBuckets; b++) {
+        if (histogram[b] == 0) {
+            continue;
+        }
+        if (b == 0) {
+            cout << " 0:";
+        } else if (b == LatencyBuckets - 1) {
+            cout << " " << (1 << (b - 1)) << "+:";
+        } else {
+            cout << " " << (1 << (b - 1)) << "-" << (1 << b) - 1 << ":";
+        }
+        cout << histogram[b];
+    }
+    cout << "\n";
+}
+
+//----------------------------------------------------------------------
+// SyscallStats::SyscallStats
+// 	Initialize the accounting, with no calls made yet.
+//
+//	"printAtHalt" -- print the statistics when Nachos halts
+//	"traceCalls" -- log every call as it is made
+//----------------------------------------------------------------------
+
+SyscallStats::SyscallStats(bool printAtHalt, bool traceCalls) {
+    report = printAtHalt;
+    trace = traceCalls;
+    for (int i = 0; i < NumSyscallCodes; i++) {
+        names[i] = NULL;
+    }
+    exited = new List<ProcessSummary *>;
+}
+
+//----------------------------------------------------------------------
+// SyscallStats::~SyscallStats
+// 	De-allocate the accounting.
+//----------------------------------------------------------------------
+
+SyscallStats::~SyscallStats() {
+    while (!exited->IsEmpty()) {
+        ProcessSummary *summary = exited->RemoveFront();
+
+        delete[] summary->name;
+        delete summary;
+    }
+    delete exited;
+}
+
+//----------------------------------------------------------------------
+// SyscallStats::Enter
+// 	Count system call "code" (called "name"), made by the current
+//	thread.
+//----------------------------------------------------------------------
+
+void SyscallStats::Enter(int code, char *name) {
+    Process *process = kernel->currentThread->process;
+
+    ASSERT(code >= 0 && code < NumSyscallCodes);
+    names[code] = name;
+    bySyscall[code].Entered();
+    if (process != NULL) {
+        process->syscalls.Entered();
+        kernel->currentThread->userThread->syscalls.Entered();
+    }
+}
+
+//----------------------------------------------------------------------
+// SyscallStats::Leave
+// 	System call "code" returns; it started at "startTick", host time
+//	"startUsecs" (0 unless IsTimingHost()).
+//----------------------------------------------------------------------
+
+void SyscallStats::Leave(int code, int startTick, double startUsecs) {
+    Process *process = kernel->currentThread->process;
+    int ticks = kernel->stats->totalTicks - startTick;
+    double usecs = 0;
+
+    if (IsTimingHost()) {
+        usecs = HostMicroseconds() - startUsecs;
+    }
+
+    bySyscall[code].Returned(ticks, usecs);
+    if (process != NULL) {
+        process->syscalls.Returned(ticks, usecs);
+        kernel->currentThread->userThread->syscalls.Returned(ticks, usecs);
+    }
+}
+
+//----------------------------------------------------------------------
+// SyscallStats::ProcessExited
+// 	Remember the system calls of a process which is going away, to
+//	report them at halt.
+//----------------------------------------------------------------------
+
+void SyscallStats::ProcessExited(Process *process) {
+    ProcessSummary *summary;
+
+    if (!report || process->syscalls.count == 0) {
+        return;
+    }
+    summary = new ProcessSummary;
+    summary->pid = process->getID();
+    summary->name = new char[strlen(process->getName()) + 1];
+    strcpy(summary->name, process->getName());
+    summary->calls = process->syscalls;
+    exited->Append(summary);
+}
+
+//----------------------------------------------------------------------
+// PrintProcess
+// 	Print the system calls of a process still alive at halt.
+//----------------------------------------------------------------------
+
+static void
+PrintProcess(Process *process) {
+    if (process->syscalls.count > 0) {
+        cout << "  " << process->getID() << " (" << process->getName() << "): ";
+        process->syscalls.Print();
+    }
+}
+
+//----------------------------------------------------------------------
+// SyscallStats::Print
+// 	Print the statistics of each kind of system call made, and of
+//	each process, if -ss was given.
+//----------------------------------------------------------------------
+
+void SyscallStats::Print() {
+    if (!report) {
+        return;
+    }
+    cout << "System calls:\n";
+    for (int code = 0; code < NumSyscallCodes; code++) {
+        if (bySyscall[code].count > 0) {
+            cout << "  " << names[code] << ": ";
+            bySyscall[code].Print();
+        }
+    }
+    cout << "System calls by process:\n";
+    ListIterator<ProcessSummary *> iter(exited);
+    for (; !iter.IsDone(); iter.Next()) {
+        cout << "  " << iter.Item()->pid << " (" << iter.Item()->name << "): ";
+        iter.Item()->calls.Print();
+    }
+    kernel->processTable->Apply(PrintProcess);
+}
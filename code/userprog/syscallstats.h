@@ -0,0 +1,78 @@
+// syscallstats.h
+//	Data structures to account for the system calls made by user
+//	programs: how many of each kind, and how long they take, in
+//	simulated ticks and in host time.
+//
+//	The counts are always kept; they cost a few additions per call.
+//	With -ss the totals are printed when Nachos halts, and with -st
+//	every call is logged as it is made, strace-style.  Host time
+//	costs two clock reads per call, so it is only taken with -ss,
+//	the one place it is printed.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYSCALLSTATS_H
+#define SYSCALLSTATS_H
+
+#include "copyright.h"
+#include "list.h"
+
+class Process;
+
+const int NumSyscallCodes = 128;  // system call codes are below this
+const int LatencyBuckets = 16;    // size of the latency histograms
+
+// The following class counts a set of system calls.  The latency
+// histogram is by powers of two: bucket 0 counts calls taking no
+// ticks, and bucket b those taking 2^(b-1) up to 2^b - 1 ticks (the
+// last bucket takes everything longer).
+
+class SyscallCounter {
+   public:
+    SyscallCounter();
+
+    void Entered() { count++; }
+    void Returned(int ticks, double usecs);  // a call took this long
+    void Print();
+
+    int count;        // calls made
+    int returned;     // ... of which returned (not Exit or Halt)
+    int totalTicks;   // simulated time spent in the calls
+    int maxTicks;
+    double hostUsecs;  // host time spent in the calls
+    int histogram[LatencyBuckets];
+};
+
+// The following class holds the system call accounting of the kernel.
+
+class SyscallStats {
+   public:
+    SyscallStats(bool printAtHalt, bool traceCalls);
+    ~SyscallStats();
+
+    void Enter(int code, char *name);  // a system call starts
+    void Leave(int code, int startTick, double startUsecs);
+    // ... and returns
+    void ProcessExited(Process *process);  // keep its totals
+    void Print();  // print everything, if asked to
+
+    bool IsTracing() { return trace; }
+    bool IsTimingHost() { return report; }  // read the host clock?
+
+   private:
+    bool report;   // print the statistics at halt?
+    bool trace;    // log each call?
+    char *names[NumSyscallCodes];  // of the calls made so far
+    SyscallCounter bySyscall[NumSyscallCodes];
+
+    struct ProcessSummary {
+        int pid;
+        char *name;  // a copy; the process is gone
+        SyscallCounter calls;
+    };
+    List<ProcessSummary *> *exited;  // processes that are gone
+};
+
+#endif  // SYSCALLSTATS_H